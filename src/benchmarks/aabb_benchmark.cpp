@@ -0,0 +1,152 @@
+// Compares the pairwise narrow phase test against aabb_batch for crowds of actors.
+// Every actor tests the four boxes the collision system uses (proposed, single pixel
+// step and the two single axis steps) against its neighbours. "test" times only the
+// overlap tests on candidates that are already gathered, "total" includes gathering
+// them out of sprite-sized records.
+//
+//   g++ -std=c++17 -O2 -march=native -o aabb_benchmark benchmarks/aabb_benchmark.cpp
+//   ./aabb_benchmark
+
+#include <array>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include "../systems/collidable.cpp"
+
+// Laid out like sprite_component, so candidate rectangles are as far apart in memory as in the game
+struct actor {
+    aabb dst;
+    int grid_x, grid_y;
+    bool visible;
+    int vel_x, vel_y;
+};
+
+// About as many candidates as a 5x5 cell neighbourhood in a crowd
+static constexpr std::size_t neighbours = 48;
+static constexpr int repeats = 20;
+
+template <typename Work>
+double time_ms(Work&& work)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeats; ++repeat) {
+        work();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+static std::array<aabb, 4> query_boxes(const actor& a)
+{
+    const int sign_x = (a.vel_x > 0) - (a.vel_x < 0), sign_y = (a.vel_y > 0) - (a.vel_y < 0);
+    return {
+        aabb{a.dst.x + a.vel_x, a.dst.y + a.vel_y, a.dst.w, a.dst.h},
+        aabb{a.dst.x + sign_x, a.dst.y + sign_y, a.dst.w, a.dst.h},
+        aabb{a.dst.x + sign_x, a.dst.y, a.dst.w, a.dst.h},
+        aabb{a.dst.x, a.dst.y + sign_y, a.dst.w, a.dst.h}
+    };
+}
+
+static std::uint64_t scalar_hits(const std::array<aabb, 4>& queries, const aabb& t)
+{
+    collidable_system s_collidable;
+    std::uint64_t hits = 0;
+    for (const aabb& q : queries) {
+        hits += s_collidable.checkCollision(q.x, q.y, q.w, q.h, t.x, t.y, t.w, t.h);
+    }
+    return hits;
+}
+
+static std::uint64_t batch_hits(const std::array<std::vector<std::uint64_t>, 4>& masks)
+{
+    std::uint64_t hits = 0;
+    for (const auto& mask : masks) {
+        for (std::uint64_t word : mask) {
+            hits += __builtin_popcountll(word);
+        }
+    }
+    return hits;
+}
+
+int main()
+{
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> position(0, 2000), velocity(-3, 3);
+
+    std::cout << "actors   scalar test   batch test   speedup   scalar total   batch total   speedup  (ms per frame)\n";
+    for (std::size_t count : {1000u, 2500u, 5000u, 10000u}) {
+        std::vector<actor> actors(count);
+        for (actor& a : actors) {
+            a.dst = {position(random), position(random), 32, 32};
+            a.vel_x = velocity(random);
+            a.vel_y = velocity(random);
+        }
+        // A fixed, scattered neighbour list per actor, like the grid cells hand back
+        std::vector<std::uint32_t> candidates(count * neighbours);
+        std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(count - 1));
+        for (auto& candidate : candidates) {
+            candidate = pick(random);
+        }
+
+        // Every actor's candidates gathered up front, once as rectangles and once as SoA
+        std::vector<aabb> gathered(count * neighbours);
+        std::vector<aabb_batch> gathered_batches(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t n = 0; n < neighbours; ++n) {
+                const aabb& t = actors[candidates[i * neighbours + n]].dst;
+                gathered[i * neighbours + n] = t;
+                gathered_batches[i].add(t.x, t.y, t.w, t.h);
+            }
+        }
+
+        std::uint64_t hits[4] = {0, 0, 0, 0};
+        aabb_batch boxes;
+        std::array<std::vector<std::uint64_t>, 4> masks;
+
+        const double scalar_test = time_ms([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto queries = query_boxes(actors[i]);
+                for (std::size_t n = 0; n < neighbours; ++n) {
+                    hits[0] += scalar_hits(queries, gathered[i * neighbours + n]);
+                }
+            }
+        });
+        const double batch_test = time_ms([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                gathered_batches[i].overlaps(query_boxes(actors[i]), masks);
+                hits[1] += batch_hits(masks);
+            }
+        });
+        const double scalar_total = time_ms([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto queries = query_boxes(actors[i]);
+                for (std::size_t n = 0; n < neighbours; ++n) {
+                    hits[2] += scalar_hits(queries, actors[candidates[i * neighbours + n]].dst);
+                }
+            }
+        });
+        const double batch_total = time_ms([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                boxes.clear();
+                for (std::size_t n = 0; n < neighbours; ++n) {
+                    const aabb& t = actors[candidates[i * neighbours + n]].dst;
+                    boxes.add(t.x, t.y, t.w, t.h);
+                }
+                boxes.overlaps(query_boxes(actors[i]), masks);
+                hits[3] += batch_hits(masks);
+            }
+        });
+
+        const bool match = hits[0] == hits[1] && hits[1] == hits[2] && hits[2] == hits[3];
+        std::cout << std::fixed;
+        std::cout.precision(3);
+        std::cout << std::setw(6) << count
+                  << std::setw(14) << scalar_test << std::setw(13) << batch_test << std::setw(9) << scalar_test / batch_test << 'x'
+                  << std::setw(15) << scalar_total << std::setw(14) << batch_total << std::setw(9) << scalar_total / batch_total << 'x'
+                  << (match ? "" : "  MISMATCH") << '\n';
+    }
+    return 0;
+}
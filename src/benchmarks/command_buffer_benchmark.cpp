@@ -0,0 +1,102 @@
+// Gives each of 1k to 100k owners a weapon from inside a view.each over their transforms,
+// recorded into a command_buffer, and checks that nothing shows up before flush() and
+// that everything does after it: the weapons, their transforms next to their owners and,
+// through health_system, each owner's owned_component. "direct" makes the same weapons
+// straight into the registry after copying the owners out of the view, which is what
+// systems had to do before, "record" is the view.each recording and "flush" applies it.
+//
+//   g++ -std=c++17 -O2 $(pkg-config --cflags sdl2) -o command_buffer_benchmark benchmarks/command_buffer_benchmark.cpp
+//   ./command_buffer_benchmark
+
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/weapon.h"
+#include "../systems/health.cpp"
+#include "../world/command_buffer.hpp"
+
+void add_owners(entt::registry& reg, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        const int x = static_cast<int>(i % 1000) * 32, y = static_cast<int>(i / 1000) * 32;
+        reg.emplace<transform_component>(reg.create(), x, y, 0, 0, to_fixed(1));
+    }
+}
+
+template <typename Work>
+double time_ms(Work&& work)
+{
+    const auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every owner has one weapon sitting on it, and the weapon in its owned_component
+bool armed(entt::registry& reg, std::size_t count)
+{
+    if (reg.storage<weapon_component>().size() != count) {
+        return false;
+    }
+    bool match = true;
+    reg.view<weapon_component, transform_component>().each([&](entt::entity weapon, weapon_component &held, transform_component &transform) {
+        const transform_component &owner = reg.get<transform_component>(held.owner_entt);
+        const owned_component* owned = reg.try_get<owned_component>(held.owner_entt);
+        match = match && transform.pos_x == owner.pos_x && transform.pos_y == owner.pos_y
+            && owned && owned->owned.size() == 1 && owned->owned.front() == weapon;
+    });
+    return match;
+}
+
+int main()
+{
+    std::cout << "   owners     direct     record      flush  (ms)\n";
+    for (std::size_t count : {1000u, 10000u, 100000u}) {
+        entt::registry direct_reg;
+        health_system direct_health;
+        command_buffer direct_commands;
+        direct_health.connect(direct_reg, direct_commands);
+        add_owners(direct_reg, count);
+        const double direct = time_ms([&] {
+            std::vector<entt::entity> owners;
+            for (entt::entity owner : direct_reg.view<transform_component>()) {
+                owners.push_back(owner);
+            }
+            for (entt::entity owner : owners) {
+                const transform_component transform = direct_reg.get<transform_component>(owner);
+                auto weapon = direct_reg.create();
+                direct_reg.emplace<weapon_component>(weapon, owner);
+                direct_reg.emplace<transform_component>(weapon, transform.pos_x, transform.pos_y, 0, 0);
+            }
+            direct_commands.flush(direct_reg);
+        });
+
+        entt::registry reg;
+        health_system health;
+        command_buffer commands;
+        health.connect(reg, commands);
+        add_owners(reg, count);
+        const double record = time_ms([&] {
+            reg.view<transform_component>().each([&](entt::entity owner, transform_component &transform) {
+                auto weapon = commands.create();
+                commands.emplace<weapon_component>(weapon, owner);
+                commands.emplace<transform_component>(weapon, transform.pos_x, transform.pos_y, 0, 0);
+            });
+        });
+        // Recorded, not applied
+        bool match = reg.storage<weapon_component>().size() == 0 && reg.storage<transform_component>().size() == count;
+
+        const double flush = time_ms([&] { commands.flush(reg); });
+        match = match && commands.empty() && commands.created().size() == count && armed(reg, count) && armed(direct_reg, count);
+
+        std::cout << std::fixed;
+        std::cout.precision(3);
+        std::cout << std::setw(9) << count << std::setw(11) << direct << std::setw(11) << record << std::setw(11) << flush
+                  << (match ? "" : "  MISMATCH") << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Compares iterating the hottest system queries as plain views against the owning groups
+// cwt::game declares (see world/groups.hpp). Two registries get the same crowd of actors,
+// each with a weapon, plus items and scenery, built in the order the game makes them and
+// then churned by deaths and respawns so the pools are no longer in creation order. Only
+// one of them has the groups. Each query runs the same loop body on both.
+//
+//   g++ -std=c++17 -O2 $(pkg-config --cflags sdl2) -o group_benchmark benchmarks/group_benchmark.cpp
+//   ./group_benchmark
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/sprite.h"
+#include "../components/collision.h"
+#include "../components/sprite_animation.h"
+#include "../components/health.h"
+#include "../world/groups.hpp"
+
+static constexpr int repeats = 20;
+static constexpr int cell = 32;
+
+template <typename Work>
+double time_ms(Work&& work)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeats; ++repeat) {
+        work();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+entt::entity add_character(entt::registry& reg, std::mt19937& random)
+{
+    std::uniform_int_distribution<int> position(0, 200 * cell), velocity(-2, 2);
+    const int x = position(random), y = position(random);
+    auto entity = reg.create();
+    reg.emplace<sprite_component>(entity, SDL_Rect{x, y, cell, cell}, x / cell, y / cell, true);
+    reg.emplace<sprite_texture_component>(entity, 128, 128, SDL_Rect{0, 0, 128, 128}, nullptr);
+    reg.emplace<sprite_character_animation_component>(entity, 1, 0, 0, 4, 11, 30);
+    reg.emplace<transform_component>(entity, x, y, velocity(random), velocity(random), to_fixed(2));
+    reg.emplace<collision_detection_component>(entity, 'E');
+    reg.emplace<hitpoints_component>(entity, 10, 10);
+    return entity;
+}
+
+// Sprite and transform but none of the character components, like weapons, items and scenery
+void add_prop(entt::registry& reg, int x, int y)
+{
+    auto entity = reg.create();
+    reg.emplace<sprite_component>(entity, SDL_Rect{x, y, cell, cell}, x / cell, y / cell, true);
+    reg.emplace<sprite_texture_component>(entity, 512, 512, SDL_Rect{0, 0, 512, 512}, nullptr);
+    reg.emplace<transform_component>(entity, x, y, 0, 0, to_fixed(0));
+}
+
+void build(entt::registry& reg, int actors)
+{
+    std::mt19937 random(1234);
+    std::vector<entt::entity> characters;
+    for (int i = 0; i < actors; ++i) {
+        characters.push_back(add_character(reg, random));
+        const transform_component transform = reg.get<transform_component>(characters.back());
+        add_prop(reg, transform.pos_x, transform.pos_y);
+        if (i % 10 == 0) {
+            add_prop(reg, transform.pos_y, transform.pos_x);
+        }
+    }
+    // A fifth of the crowd dies and respawns
+    std::uniform_int_distribution<std::size_t> pick(0, characters.size() - 1);
+    for (int i = 0; i < actors / 5; ++i) {
+        entt::entity& victim = characters[pick(random)];
+        reg.destroy(victim);
+        victim = add_character(reg, random);
+    }
+}
+
+// The loop bodies of the systems, taking a view or a group with the components in the same order
+
+template <typename Query>
+std::uint64_t sprite_update(Query query)
+{
+    std::uint64_t sum = 0;
+    query.each([&](sprite_component& sprite, transform_component& transform) {
+        sprite.dst.x = transform.pos_x;
+        sprite.dst.y = transform.pos_y;
+        sprite.grid_x = sprite.dst.x / cell;
+        sprite.grid_y = sprite.dst.y / cell;
+        sum += sprite.grid_x + sprite.grid_y;
+    });
+    return sum;
+}
+
+template <typename Query>
+std::uint64_t collision_update(Query query)
+{
+    std::uint64_t sum = 0;
+    query.each([&](sprite_component& sprite, transform_component& transform, collision_detection_component&) {
+        sum += (transform.pos_x + transform.vel_x + sprite.dst.w) ^ (transform.pos_y + transform.vel_y + sprite.dst.h);
+    });
+    return sum;
+}
+
+template <typename Query>
+std::uint64_t animation_update(Query query)
+{
+    std::uint64_t sum = 0;
+    query.each([&](sprite_character_animation_component& animation, sprite_texture_component& sprite_texture,
+                   hitpoints_component& hp, sprite_component& sprite, transform_component& transform) {
+        const bool running = transform.vel_x != 0 || transform.vel_y != 0;
+        animation.sprite_frame_count = (animation.sprite_frame_count + 1) % (hp.stunned ? 10 : 2);
+        animation.sprite_selection_count = running ? animation.sprite_x_count_first : 0;
+        sprite_texture.src.x = sprite_texture.src_origin.x + animation.sprite_selection_count * sprite_texture.src_w;
+        sum += sprite_texture.src.x + sprite.visible;
+    });
+    return sum;
+}
+
+int main()
+{
+    std::cout << "actors  entities  query                                  view     group   speedup  (ms per pass)\n";
+    for (int actors : {10000, 50000, 100000}) {
+        entt::registry viewed, grouped;
+        declare_groups(grouped);
+        build(viewed, actors);
+        build(grouped, actors);
+
+        struct row {
+            const char* name;
+            double view_ms, group_ms;
+            bool match;
+        };
+        std::uint64_t view_sum = 0, group_sum = 0;
+        std::vector<row> rows;
+        auto compare = [&](const char* name, auto&& on_view, auto&& on_group) {
+            view_sum = group_sum = 0;
+            const double view_ms = time_ms([&] { view_sum += on_view(); });
+            const double group_ms = time_ms([&] { group_sum += on_group(); });
+            rows.push_back({name, view_ms, group_ms, view_sum == group_sum});
+        };
+        compare("sprite + transform",
+            [&] { return sprite_update(viewed.view<sprite_component, transform_component>()); },
+            [&] { return sprite_update(grouped.group<sprite_component, transform_component>()); });
+        compare("sprite + transform + collision_detection",
+            [&] { return collision_update(viewed.view<sprite_component, transform_component, collision_detection_component>()); },
+            [&] { return collision_update(grouped.group<sprite_component, transform_component, collision_detection_component>()); });
+        compare("animation + texture + hitpoints + ...",
+            [&] { return animation_update(viewed.view<sprite_character_animation_component, sprite_texture_component, hitpoints_component,
+                      sprite_component, transform_component>()); },
+            [&] { return animation_update(grouped.group<sprite_character_animation_component, sprite_texture_component, hitpoints_component>(
+                      entt::get<sprite_component, transform_component>)); });
+
+        std::cout << std::fixed;
+        std::cout.precision(3);
+        for (const row& r : rows) {
+            std::cout << std::setw(6) << actors << std::setw(10) << viewed.storage<sprite_component>().size() << "  "
+                      << std::left << std::setw(40) << r.name << std::right
+                      << std::setw(7) << r.view_ms << std::setw(10) << r.group_ms << std::setw(9) << r.view_ms / r.group_ms << 'x'
+                      << (r.match ? "" : "  MISMATCH") << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,390 @@
+// Times the core systems one at a time on generated worlds of 100 to 100k actors and
+// prints the results as JSON. Each population gets a generated map.txt style grid sized to
+// the crowd, a player, enemies with weapons, items and animated scenery. Nothing is drawn:
+// there is no window or renderer, so SDL is never initialised.
+//
+//   g++ -std=c++17 -O2 -pthread $(pkg-config --cflags sdl2) -o systems_benchmark benchmarks/systems_benchmark.cpp $(pkg-config --libs sdl2 sdl2_image)
+//   ./systems_benchmark [--populations 100,1000,10000,100000] [--iterations 20] [--out results.json]
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/sprite.h"
+#include "../components/label.h"
+#include "../components/collision.h"
+#include "../components/collidable.h"
+#include "../components/path_finding.h"
+#include "../components/targetting.h"
+#include "../components/sprite_animation.h"
+#include "../components/health.h"
+#include "../components/damage.h"
+#include "../components/combat.h"
+#include "../components/player.h"
+#include "../components/render_layer.h"
+#include "../components/weapon.h"
+#include "../components/item.h"
+#include "../components/inventory.h"
+#include "../config/game_config.h"
+
+#include "../world/texture_cache.hpp"
+#include "../world/load_map.cpp"
+#include "../world/groups.hpp"
+#include "../systems/sprite.cpp"
+#include "../systems/collision.cpp"
+#include "../systems/path_finding.cpp"
+#include "../systems/sprite_animation.cpp"
+#include "../systems/health.cpp"
+#include "../systems/combat.cpp"
+
+struct benchmark_options {
+    std::vector<int> populations{100, 1000, 10000, 100000};
+    int iterations = 20;
+    const char* out_path = nullptr;
+};
+
+benchmark_options parse_benchmark_options(int argc, char* argv[])
+{
+    benchmark_options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--populations") == 0 && i + 1 < argc) {
+            options.populations.clear();
+            std::stringstream list(argv[++i]);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                options.populations.push_back(std::atoi(count.c_str()));
+            }
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options.out_path = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << '\n';
+        }
+    }
+    return options;
+}
+
+// Timings of one system in microseconds
+struct system_result {
+    std::string name;
+    std::vector<double> samples;
+
+    double percentile(double p) const
+    {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+    }
+
+    double mean() const
+    {
+        double total = 0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        return total / samples.size();
+    }
+};
+
+// One population: the world, the systems under test and what they measured
+struct population {
+    int actors = 0;
+    map_dimensions map;
+    std::size_t entities = 0; // With a sprite: actors, weapons, items and scenery
+    std::vector<system_result> results;
+
+    entt::registry reg;
+    texture_cache textures; // No renderer, so it never loads anything
+    entt::entity player = entt::null;
+    std::vector<entt::entity> enemies;
+    std::vector<int> open_cells;
+    std::mt19937 random{1234};
+};
+
+// Mostly floor with short wall runs, a wall border and about a quarter of the cells per actor
+std::string generate_map(int actors, int& columns, int& rows, std::mt19937& random)
+{
+    columns = std::max(GameConfig::instance().num_columns, static_cast<int>(std::ceil(std::sqrt(actors * 4.0))));
+    rows = std::max(GameConfig::instance().num_rows, columns * 2 / 3);
+
+    std::vector<std::string> lines(rows, std::string(columns, 'g'));
+    for (int x = 0; x < columns; ++x) {
+        lines[0][x] = lines[rows - 1][x] = 'd';
+    }
+    for (int y = 0; y < rows; ++y) {
+        lines[y][0] = lines[y][columns - 1] = 'd';
+    }
+    std::uniform_int_distribution<int> column(1, columns - 2), row(1, rows - 2), length(2, 8), vertical(0, 1);
+    for (int wall = 0; wall < columns * rows / 40; ++wall) {
+        int x = column(random), y = row(random);
+        const bool down = vertical(random);
+        for (int step = length(random); step > 0 && x < columns - 1 && y < rows - 1; --step) {
+            lines[y][x] = 'd';
+            (down ? y : x) += 1;
+        }
+    }
+
+    std::string text;
+    for (const std::string& line : lines) {
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+entt::entity add_character(population& world, int x, int y, char type)
+{
+    const int width = GameConfig::instance().grid_cell_width;
+    const int height = GameConfig::instance().grid_cell_height;
+    entt::registry& reg = world.reg;
+    auto entity = reg.create();
+    reg.emplace<sprite_component>(entity, SDL_Rect{x, y, width, height}, x / width, y / height, true);
+    reg.emplace<sprite_texture_component>(entity, 128, 128, SDL_Rect{0, 0, 0, 0}, nullptr);
+    reg.emplace<label_component>(entity, type == 'F' ? entity_label::player : entity_label::enemy);
+    reg.emplace<sprite_character_animation_component>(entity, 1, 0, 0, 4, 11, 30);
+    reg.emplace<transform_component>(entity, x, y, 0, 0, to_fixed(type == 'F' ? 4 : 1));
+    reg.emplace<collision_detection_component>(entity, type);
+    reg.emplace<collidable_component>(entity, true);
+    reg.emplace<hitpoints_component>(entity, 10, 10);
+    reg.emplace<life_bar_component>(entity, width, 8, SDL_Color{0, 255, 0, 255}, SDL_Rect{x, y, width, 8});
+    reg.emplace<combat_component>(entity, type == 'E', false, 10, 0, 0, 3000, Uint32{0});
+    reg.emplace<layer_two_component>(entity);
+    return entity;
+}
+
+void add_weapon(population& world, entt::entity owner, char type)
+{
+    entt::registry& reg = world.reg;
+    const transform_component& owner_transform = reg.get<transform_component>(owner);
+    auto weapon = reg.create();
+    reg.emplace<weapon_component>(weapon, owner);
+    reg.emplace<damage_component>(weapon, 1, false, false, false, true, type);
+    reg.emplace<sprite_component>(weapon,
+        SDL_Rect{owner_transform.pos_x, owner_transform.pos_y, GameConfig::instance().grid_cell_width, GameConfig::instance().grid_cell_height},
+        0, 0, false);
+    reg.emplace<sprite_texture_component>(weapon, 325, 743, SDL_Rect{0, 0, 325, 743}, nullptr);
+    reg.emplace<label_component>(weapon, entity_label::weapon);
+    reg.emplace<transform_component>(weapon, owner_transform.pos_x, owner_transform.pos_y, 0, 0);
+    reg.emplace<collidable_component>(weapon, false);
+    reg.emplace<layer_one_component>(weapon);
+}
+
+void add_item(population& world, int x, int y)
+{
+    entt::registry& reg = world.reg;
+    auto item = reg.create();
+    reg.emplace<sprite_component>(item, SDL_Rect{x, y, GameConfig::instance().grid_cell_width, GameConfig::instance().grid_cell_height}, 0, 0, true);
+    reg.emplace<sprite_texture_component>(item, 512, 512, SDL_Rect{0, 0, 512, 512}, nullptr);
+    reg.emplace<label_component>(item, entity_label::item);
+    reg.emplace<transform_component>(item, x, y, 0, 0, to_fixed(0));
+    reg.emplace<collidable_component>(item, true);
+    reg.emplace<item_component>(item, std::string("Sword"));
+    reg.emplace<layer_two_component>(item);
+}
+
+void add_scenery(population& world, int x, int y)
+{
+    entt::registry& reg = world.reg;
+    auto scenery = reg.create();
+    reg.emplace<sprite_component>(scenery, SDL_Rect{x, y, GameConfig::instance().grid_cell_width * 2, GameConfig::instance().grid_cell_height * 2}, 0, 0, true);
+    reg.emplace<sprite_texture_component>(scenery, 0, 0, SDL_Rect{0, 0, 0, 0}, nullptr);
+    reg.emplace<label_component>(scenery, entity_label::scenery);
+    reg.emplace<sprite_scenery_animation_component>(scenery, 0, 0, 4, 0);
+    reg.emplace<transform_component>(scenery, x, y, 0, 0, to_fixed(0));
+    reg.emplace<collidable_component>(scenery, true);
+    reg.emplace<layer_two_component>(scenery);
+}
+
+// The map, then one player, the enemies each with a weapon, an item per 10 and scenery per 20 actors
+void build_population(population& world, int actors)
+{
+    world.actors = actors;
+    declare_groups(world.reg);
+    int columns = 0, rows = 0;
+    const std::string map_text = generate_map(actors, columns, rows, world.random);
+    const std::filesystem::path map_path = std::filesystem::temp_directory_path() / "dwarf_quest_benchmark_map.txt";
+    std::ofstream(map_path) << map_text;
+
+    world.map = load_map(map_path.string(), world.reg, world.textures);
+    std::filesystem::remove(map_path);
+
+    for (int y = 1; y < rows - 1; ++y) {
+        for (int x = 1; x < columns - 1; ++x) {
+            if (map_text[y * (columns + 1) + x] == 'g') {
+                world.open_cells.push_back(y * columns + x);
+            }
+        }
+    }
+    std::uniform_int_distribution<std::size_t> pick(0, world.open_cells.size() - 1);
+    auto random_position = [&] {
+        const int cell = world.open_cells[pick(world.random)];
+        return std::make_pair(cell % columns * GameConfig::instance().grid_cell_width, cell / columns * GameConfig::instance().grid_cell_height);
+    };
+
+    auto [player_x, player_y] = random_position();
+    world.player = add_character(world, player_x, player_y, 'F');
+    world.reg.emplace<player_component>(world.player);
+    world.reg.emplace<inventory_component>(world.player);
+    add_weapon(world, world.player, 'F');
+
+    for (int i = 1; i < actors; ++i) {
+        auto [x, y] = random_position();
+        const entt::entity enemy = add_character(world, x, y, 'E');
+        world.reg.emplace<targetting_component>(enemy, world.player, player_x, player_y, player_x, player_y);
+        world.reg.emplace<path_finding_component>(enemy, Uint32{0}, false);
+        add_weapon(world, enemy, 'E');
+        world.enemies.push_back(enemy);
+    }
+    for (int i = 0; i < actors / 10; ++i) {
+        auto [x, y] = random_position();
+        add_item(world, x, y);
+    }
+    for (int i = 0; i < actors / 20; ++i) {
+        auto [x, y] = random_position();
+        add_scenery(world, x, y);
+    }
+    world.entities = world.reg.storage<sprite_component>().size();
+}
+
+// Runs setup (untimed) then work (timed) iterations times
+void measure(population& world, const char* name, int iterations, const std::function<void()>& setup, const std::function<void()>& work)
+{
+    system_result result{name, {}};
+    for (int i = 0; i < iterations; ++i) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        result.samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    world.results.push_back(std::move(result));
+}
+
+void run_population(population& world, int iterations)
+{
+    entt::registry& reg = world.reg;
+    const int columns = world.map.columns, rows = world.map.rows;
+    const SDL_Rect whole_world{0, 0, columns * GameConfig::instance().grid_cell_width, rows * GameConfig::instance().grid_cell_height};
+    Uint32 now = 0;
+    auto no_setup = [] {};
+
+    sprite_system sprites;
+    sprites.resize(columns, rows);
+    measure(world, "sprite_system::update", iterations, no_setup, [&] { sprites.update(reg); });
+
+    // Every actor tries to move 1-4 px a frame, the velocities are put back before each run
+    collision_system collisions;
+    collisions.resize(columns, rows);
+    collisions.connect(reg);
+    std::uniform_int_distribution<int> velocity(-4, 4);
+    auto randomise_velocities = [&] {
+        reg.view<transform_component, collision_detection_component>().each([&](transform_component& transform, collision_detection_component&) {
+            transform.vel_x = velocity(world.random);
+            transform.vel_y = velocity(world.random);
+            transform.move_x = to_fixed(transform.vel_x);
+            transform.move_y = to_fixed(transform.vel_y);
+        });
+    };
+    measure(world, "collision_system::update", iterations, randomise_velocities, [&] { collisions.update(reg); });
+
+    path_finding_system paths;
+    paths.resize(columns, rows);
+    paths.connect(reg);
+    measure(world, "path_finding_system::update", iterations, [&] { now += GameConfig::instance().frame_delay; }, [&] { paths.update(reg, now); });
+
+    // 100 routes between random open cells per run
+    std::vector<int> route;
+    std::uniform_int_distribution<std::size_t> pick(0, world.open_cells.size() - 1);
+    std::vector<std::pair<int, int>> queries(100);
+    measure(world, "path_finding_system::find_path x100", iterations,
+        [&] {
+            for (auto& query : queries) {
+                query = {world.open_cells[pick(world.random)], world.open_cells[pick(world.random)]};
+            }
+        },
+        [&] {
+            for (const auto& [start, goal] : queries) {
+                paths.find_path(start % columns, start / columns, goal % columns, goal / columns, route);
+            }
+        });
+
+    sprite_animation_system animation;
+    measure(world, "sprite_animation_system::update", iterations, randomise_velocities, [&] { animation.update(reg, whole_world); });
+
+    // Nobody is dead, so this is the cost of checking
+    health_system health;
+    command_buffer commands;
+    measure(world, "health_system::update", iterations, no_setup, [&] {
+        health.update(reg, commands);
+        commands.flush(reg);
+    });
+
+    // Everyone swings every run
+    combat_system combat;
+    measure(world, "combat_system::update_weapon_states", iterations,
+        [&] {
+            now += 3000;
+            reg.view<combat_component>().each([](combat_component& fighter) { fighter.attacking = true; });
+        },
+        [&] { combat.update_weapon_states(reg, now); });
+
+    // The systems listen for destroyed collidables, so let them go while the systems still exist
+    reg.clear<collidable_component>();
+}
+
+void write_json(std::ostream& out, const std::vector<population*>& worlds, int iterations)
+{
+    out << "{\n  \"benchmark\": \"systems\",\n  \"iterations\": " << iterations << ",\n  \"populations\": [\n";
+    for (std::size_t p = 0; p < worlds.size(); ++p) {
+        const population& world = *worlds[p];
+        out << "    {\n      \"actors\": " << world.actors
+            << ",\n      \"entities\": " << world.entities
+            << ",\n      \"map\": {\"columns\": " << world.map.columns << ", \"rows\": " << world.map.rows << "}"
+            << ",\n      \"systems\": [\n";
+        for (std::size_t s = 0; s < world.results.size(); ++s) {
+            const system_result& result = world.results[s];
+            out << "        {\"name\": \"" << result.name << "\", \"mean_us\": " << result.mean()
+                << ", \"p50_us\": " << result.percentile(0.5) << ", \"p95_us\": " << result.percentile(0.95)
+                << ", \"min_us\": " << result.percentile(0.0) << "}" << (s + 1 < world.results.size() ? "," : "") << '\n';
+        }
+        out << "      ]\n    }" << (p + 1 < worlds.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    const benchmark_options options = parse_benchmark_options(argc, argv);
+
+    std::vector<std::unique_ptr<population>> worlds;
+    std::vector<population*> finished;
+    for (int actors : options.populations) {
+        worlds.push_back(std::make_unique<population>());
+        population& world = *worlds.back();
+        std::cerr << "Building " << actors << " actors\n";
+        build_population(world, actors);
+        run_population(world, options.iterations);
+        finished.push_back(&world);
+    }
+
+    if (options.out_path) {
+        std::ofstream out(options.out_path, std::ios::trunc);
+        write_json(out, finished, options.iterations);
+    } else {
+        write_json(std::cout, finished, options.iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Times transform_system's fixed point integration step over 100k and 1M transforms with
+// fractional speeds in every direction, an eighth of them cut short by a collision each
+// frame. "int step" is the old whole pixel pos += vel loop for reference, "kernel" is
+// transform_system::integrate over one packed array and "registry" is
+// transform_system::update, which runs it over the registry's storage page by page. The checksum is of the final positions and
+// fractions, and should be the same on every machine and compiler.
+//
+//   g++ -std=c++17 -O2 -o transform_benchmark benchmarks/transform_benchmark.cpp
+//   ./transform_benchmark
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/weapon.h"
+#include "../systems/transform.cpp"
+
+static constexpr int frames = 50;
+
+// Sets up the frame like the game does before the step: whole pixels from the velocity,
+// then collision stops some of them
+void plan(transform_component* transforms, std::size_t count, const std::vector<std::uint8_t>& blocked, int frame)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        transform_component& transform = transforms[i];
+        transform.vel_x = whole_pixels(transform.sub_x + transform.move_x);
+        transform.vel_y = whole_pixels(transform.sub_y + transform.move_y);
+        if (blocked[(i + frame) % blocked.size()]) {
+            transform.vel_x = 0;
+        }
+    }
+}
+
+std::uint64_t checksum(const transform_component* transforms, std::size_t count)
+{
+    std::uint64_t hash = 1469598103934665603ull;
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::int64_t value : {std::int64_t(transforms[i].pos_x), std::int64_t(transforms[i].pos_y),
+                                   std::int64_t(transforms[i].sub_x), std::int64_t(transforms[i].sub_y)}) {
+            hash = (hash ^ static_cast<std::uint64_t>(value)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// Average ms per frame of step, with plan run untimed before each one
+template <typename Step>
+double time_frames(transform_component* transforms, std::size_t count, const std::vector<std::uint8_t>& blocked, Step&& step)
+{
+    double total = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        plan(transforms, count, blocked, frame);
+        const auto start = std::chrono::steady_clock::now();
+        step();
+        total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return total / frames;
+}
+
+int main()
+{
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> position(0, 30000), heading(-100, 100), speed(fixed_one / 4, to_fixed(4)), chance(0, 7);
+
+    std::cout << "transforms   int step     kernel   registry  (ms per frame)  checksum\n";
+    for (std::size_t count : {100000u, 1000000u}) {
+        std::vector<transform_component> transforms(count);
+        for (transform_component& transform : transforms) {
+            transform.pos_x = position(random);
+            transform.pos_y = position(random);
+            transform.speed = speed(random);
+            normalise(heading(random), heading(random), transform.speed, transform.move_x, transform.move_y);
+        }
+        std::vector<std::uint8_t> blocked(4096);
+        for (auto& axis : blocked) {
+            axis = chance(random) == 0;
+        }
+
+        std::vector<transform_component> whole = transforms;
+        const double int_step = time_frames(whole.data(), count, blocked, [&] {
+            for (transform_component& transform : whole) {
+                transform.pos_x += transform.vel_x;
+                transform.pos_y += transform.vel_y;
+            }
+        });
+
+        std::vector<transform_component> packed = transforms;
+        const double kernel = time_frames(packed.data(), count, blocked, [&] {
+            transform_system::integrate(packed.data(), count);
+        });
+
+        // Same start and same frames through the registry, whatever order its pool is in
+        entt::registry reg;
+        std::vector<entt::entity> entities(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            entities[i] = reg.create();
+            reg.emplace<transform_component>(entities[i], transforms[i]);
+        }
+        transform_system system;
+        double registry = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            for (std::size_t i = 0; i < count; ++i) {
+                plan(&reg.get<transform_component>(entities[i]), 1, blocked, static_cast<int>(i) + frame);
+            }
+            const auto start = std::chrono::steady_clock::now();
+            system.update(reg);
+            registry += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        registry /= frames;
+        for (std::size_t i = 0; i < count; ++i) {
+            transforms[i] = reg.get<transform_component>(entities[i]);
+        }
+
+        const std::uint64_t sum = checksum(packed.data(), count);
+        std::cout << std::fixed;
+        std::cout.precision(3);
+        std::cout << std::setw(10) << count << std::setw(11) << int_step << std::setw(11) << kernel << std::setw(11) << registry
+                  << "                 " << std::hex << sum << std::dec
+                  << (sum == checksum(transforms.data(), count) ? "" : "  MISMATCH") << '\n';
+    }
+    return 0;
+}
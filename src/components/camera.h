@@ -0,0 +1,10 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <SDL2/SDL.h>
+
+struct camera_component{
+    SDL_Rect view;                      // World pixels shown on screen, screen sized
+    entt::entity target = entt::null;   // Entity kept in the middle, the first player when null
+};
@@ -5,5 +5,4 @@
 struct collision_detection_component {
     // Type of damage  (F)riendly / (E)nemy / (N)eutral
     char type = 'N';
-    std::vector<entt::entity> collided_entities;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+// 16.16 fixed point: whole pixels in the high 16 bits, 1/65536ths of a pixel in the low 16.
+// Only integer maths is used, so every machine gets the same results (replays rely on it).
+using fixed = std::int32_t;
+
+constexpr int fixed_shift = 16;
+constexpr fixed fixed_one = fixed(1) << fixed_shift;
+
+constexpr fixed to_fixed(int pixels) { return pixels * fixed_one; }
+
+// Rounded down, so -0.25 is -1 pixel plus a 0.75 fraction and fractions are never negative.
+// Right shifting a negative int is implementation defined before C++20, so the bits are
+// shifted as unsigned after adding 2^31, which moves every value up by the same whole
+// number of pixels (2^15) and keeps the order. Subtracting that puts the sign back.
+constexpr std::uint32_t fixed_bias = std::uint32_t(1) << 31;
+constexpr int whole_pixels(fixed value)
+{
+    return static_cast<int>((static_cast<std::uint32_t>(value) + fixed_bias) >> fixed_shift) - static_cast<int>(fixed_bias >> fixed_shift);
+}
+constexpr fixed pixel_fraction(fixed value) { return static_cast<fixed>(static_cast<std::uint32_t>(value) & (fixed_one - 1)); }
+
+// Floor of the square root
+inline std::uint64_t integer_sqrt(std::uint64_t value)
+{
+    std::uint64_t root = 0;
+    std::uint64_t bit = std::uint64_t(1) << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// The direction (x, y) at length speed, so diagonals are no faster than straight lines.
+// Zero when x and y both are.
+inline void normalise(int x, int y, fixed speed, fixed& out_x, fixed& out_y)
+{
+    if (x == 0 && y == 0) {
+        out_x = out_y = 0;
+        return;
+    }
+    // Only the direction matters, so shrink it until the squared length in 32.32 fits
+    while (std::abs(x) > 0x7fff || std::abs(y) > 0x7fff) {
+        x /= 2;
+        y /= 2;
+    }
+    const std::uint64_t squared = static_cast<std::uint64_t>(std::int64_t(x) * x + std::int64_t(y) * y) << (2 * fixed_shift);
+    const std::int64_t length = static_cast<std::int64_t>(integer_sqrt(squared)); // 16.16
+    out_x = static_cast<fixed>(std::int64_t(speed) * x * fixed_one / length);
+    out_y = static_cast<fixed>(std::int64_t(speed) * y * fixed_one / length);
+}
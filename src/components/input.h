@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Everything the player can do in a single frame.
+// Systems read this instead of SDL_GetKeyboardState() so a frame can be fed from
+// the keyboard, a replay file or nothing at all (headless).
+struct input_state
+{
+    bool left = false;
+    bool right = false;
+    bool up = false;
+    bool down = false;
+    bool attack = false;
+    bool quit = false;
+
+    std::uint8_t to_bits() const
+    {
+        return (left << 0) | (right << 1) | (up << 2) | (down << 3) | (attack << 4) | (quit << 5);
+    }
+
+    static input_state from_bits(std::uint8_t bits)
+    {
+        input_state input;
+        input.left = bits & (1 << 0);
+        input.right = bits & (1 << 1);
+        input.up = bits & (1 << 2);
+        input.down = bits & (1 << 3);
+        input.attack = bits & (1 << 4);
+        input.quit = bits & (1 << 5);
+        return input;
+    }
+};
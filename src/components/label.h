@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// What kind of thing an entity is, kept as an id instead of a string per entity
+enum class entity_label : std::uint8_t {
+    player,
+    enemy,
+    weapon,
+    item,
+    scenery,
+};
+
+struct label_component {
+    entity_label label;
+};
+
+inline const char* label_name(entity_label label)
+{
+    switch (label) {
+        case entity_label::player: return "PLAYER";
+        case entity_label::enemy: return "ENEMY";
+        case entity_label::weapon: return "WEAPON";
+        case entity_label::item: return "ITEM";
+        case entity_label::scenery: return "SCENERY";
+    }
+    return "UNKNOWN";
+}
@@ -5,19 +5,10 @@
 
 #include <SDL2/SDL.h>
 
-struct Node {
-    int grid_x, grid_y;
-    int g_cost = 0;
-    int h_cost = 0;
-    bool visited = false;
-    Node* parent = nullptr;
-
-    int f_cost() const { return g_cost + h_cost; }
-};
-
 struct path_finding_component {
     Uint32 last_path_find_time; 
     bool initialised;
-    std::vector<Node> path;
+    std::vector<int> path; // Grid cell indices (y * map columns + x) from this entity to its target
     int target_node;
+    int path_length = 0; // Cells from this entity to its target including both ends, 0 if unreachable
 };
\ No newline at end of file
@@ -1,5 +1,4 @@
 #pragma once
 
-struct background_component{ };
 struct layer_one_component{ };
 struct layer_two_component{ };
\ No newline at end of file
@@ -3,12 +3,18 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+// Where a sprite is. Movement, collision, path finding and culling read this every frame,
+// so it holds nothing else and stays packed tightly in its pool.
 struct sprite_component{
-    int src_w, src_h; // Used in sprite animation
-    SDL_Rect src;
     SDL_Rect dst;
-    SDL_Texture* texture;
     int grid_x, grid_y; // Grid position on the map
     bool visible;
-    std::string label;
-};
\ No newline at end of file
+};
+
+// What a sprite is drawn with, only read by the animation and render passes
+struct sprite_texture_component{
+    int src_w, src_h; // Used in sprite animation
+    SDL_Rect src;
+    SDL_Texture* texture;
+    SDL_Point src_origin{0, 0}; // Where the image starts inside texture (non zero on an atlas page)
+};
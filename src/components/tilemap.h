@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <SDL2/SDL.h>
+
+// What every tile of one tile id looks like and does
+struct tile_type {
+    SDL_Texture* texture = nullptr;
+    SDL_Rect src{0, 0, 0, 0}; // Inside texture, atlas origin included
+    bool collidable = false;  // Blocks movement like a collidable_component with block_movement
+};
+
+// The map's terrain on one entity: a tile id per cell of every layer and a palette indexed
+// by tile id, instead of an entity per tile. Code that edits tiles should go through set()
+// and then reg.patch<tilemap_component>() so the renderer and path finding see the change.
+struct tilemap_component {
+    int columns = 0;
+    int rows = 0;
+    int layers = 0;
+    int tile_width = 0;  // Cell size in pixels
+    int tile_height = 0;
+    std::vector<std::uint16_t> tiles;   // Layer by layer, row by row, 0 for no tile
+    std::vector<std::uint8_t> blocked;  // Per cell, 1 when a tile on any layer is collidable
+    std::vector<tile_type> palette;
+
+    std::uint16_t at(int layer, int column, int row) const
+    {
+        return tiles[(static_cast<std::size_t>(layer) * rows + row) * columns + column];
+    }
+
+    // False outside the map
+    bool blocks(int column, int row) const
+    {
+        return column >= 0 && row >= 0 && column < columns && row < rows && blocked[row * columns + column];
+    }
+
+    void set(int layer, int column, int row, std::uint16_t tile)
+    {
+        tiles[(static_cast<std::size_t>(layer) * rows + row) * columns + column] = tile;
+        std::uint8_t blocking = 0;
+        for (int l = 0; l < layers; ++l) {
+            const std::uint16_t id = at(l, column, row);
+            blocking |= id < palette.size() && palette[id].collidable;
+        }
+        blocked[row * columns + column] = blocking;
+    }
+
+    // Pixel rectangle of a cell
+    SDL_Rect cell_rect(int column, int row) const
+    {
+        return SDL_Rect{column * tile_width, row * tile_height, tile_width, tile_height};
+    }
+};
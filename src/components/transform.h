@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "fixed_point.h"
+
 enum class Direction {
     U, // Up
     D, // Down
@@ -15,8 +17,10 @@ enum class Direction {
 };
 
 struct transform_component{
-    int pos_x, pos_y;   // Screen position
-    int vel_x, vel_y;   // Velocity
-    int speed = 1;
+    int pos_x, pos_y;   // Screen position in whole pixels
+    int vel_x, vel_y;   // Whole pixels to move this frame, see transform_system
+    fixed speed = fixed_one; // Pixels per frame in any direction
     Direction direction;  
-};
\ No newline at end of file
+    fixed move_x = 0, move_y = 0; // Velocity in pixels per frame, set by movement_system
+    fixed sub_x = 0, sub_y = 0;   // How far past pos_x/pos_y it really is, under a pixel
+};
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <vector>
+
 #include <entt/entt.hpp>
 
 struct weapon_component {
     entt::entity owner_entt; // Who owns the weapon
 };
+
+// What an entity owns, kept up to date by health_system from weapon_component so the owner
+// can find its weapons without searching every weapon
+struct owned_component {
+    std::vector<entt::entity> owned;
+};
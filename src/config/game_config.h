@@ -2,6 +2,19 @@
 
 #include <fstream> 
 
+// How enemies work out their route to a target
+enum class PathFindingMode {
+    AStar,          // A* per enemy, throttled to one re-path per frame
+    FlowField,      // One breadth first search from each target per frame, shared by every enemy
+    Hierarchical,   // Like AStar but long routes go through a cluster graph of the walls (HPA*)
+};
+
+// How movers are stopped by what they run into
+enum class CollisionMode {
+    Discrete,   // Test the full step and a 1 pixel step, stop on the axes that hit
+    Swept,      // Move to the exact time of impact along the path and slide along what was hit
+};
+
 struct GameConfig {
     // Public static method to access the singleton instance
     static GameConfig& instance() {
@@ -20,6 +33,14 @@ struct GameConfig {
     const int target_fps = 20;               
     const int frame_delay = 1000 / target_fps;
 
+    PathFindingMode path_finding_mode = PathFindingMode::FlowField;
+    bool path_finding_diagonals = false; // A* may step diagonally (octile costs) when true
+    int path_finding_cluster_size = 10;  // Cluster width/height in cells for PathFindingMode::Hierarchical
+
+    CollisionMode collision_mode = CollisionMode::Discrete;
+
+    unsigned worker_threads = 0; // Threads running the systems each frame, 0 for one per hardware thread
+
     // Delete copy constructor and assignment operator to enforce singleton
     GameConfig(const GameConfig&) = delete;
     GameConfig& operator=(const GameConfig&) = delete;
@@ -1,33 +1,106 @@
+#include <cstring>
+#include <cstdlib>
+
 #include "world/game.hpp"
 
 #include "config/game_config.h"
 
 #include "world/initialise_entities.cpp"
 
+// Command line options:
+//   --headless          no window, renderer or frame sleeps, fixed step clock
+//   --frames <n>        stop after n frames (headless defaults to one simulated minute)
+//   --record <file>     record every frame's input to file
+//   --replay <file>     play back input recorded with --record
+//   --profile           time every system and print p50/p95/p99 at exit (P prints it in game)
+//   --trace <file>      profile and write a Chrome trace (open in Perfetto) at exit
+struct launch_options {
+    bool headless = false;
+    Uint32 max_frames = 0;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    bool profile = false;
+    const char* trace_path = nullptr;
+};
+
+launch_options parse_launch_options(int argc, char* argv[])
+{
+    launch_options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.max_frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            options.record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            options.profile = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << '\n';
+        }
+    }
+
+    if (options.headless && options.max_frames == 0 && !options.replay_path) {
+        options.max_frames = GameConfig::instance().target_fps * 60;
+    }
+    return options;
+}
+
 int main(int argc, char* argv[]) 
 {             
     const int frame_delay = GameConfig::instance().frame_delay;
+    const launch_options options = parse_launch_options(argc, argv);
 
     const int player_height = GameConfig::instance().grid_cell_height;
     const int player_width = GameConfig::instance().grid_cell_width;
-    cwt::game game;
+    cwt::game game(options.headless);
+
+    // Recording and replaying need the same fixed timings on both runs
+    if (options.record_path || options.replay_path) {
+        game.get_clock().fixed_step = true;
+    }
+    if (options.record_path && !game.get_input_replay().start_recording(options.record_path)) {
+        std::cerr << "Error: Could not open " << options.record_path << " for recording\n";
+        return 1;
+    }
+    if (options.replay_path && !game.get_input_replay().start_replay(options.replay_path)) {
+        std::cerr << "Error: Could not open replay " << options.replay_path << '\n';
+        return 1;
+    }
+    if (options.profile || options.trace_path) {
+        game.get_profiler().enable();
+    }
     
     entt::registry m_registry;
 
+    // Decode the character and scenery sheets in the background while the world is set up
+    game.get_texture_cache().preload_async({
+        "assets/images/zombie.png",
+        "assets/images/explosion-rays.png",
+        "assets/images/undead_tileset/PNG/Animation1.png",
+        "assets/images/undead_tileset/PNG/Animation4.png",
+        "assets/images/undead_tileset/PNG/Animation5.png",
+        "assets/images/undead_tileset/PNG/Animation6.png",
+    });
+
     // Create player character
     const char* weapon_path = "assets/images/sword.png";
     const char* player_path = "assets/images/player.png";
     auto player_character = create_player_animated(game, player_path, 10, 10);
-    auto player_weapon = create_weapon(game, weapon_path, 10, 10, player_character);
+    auto player_weapon = create_weapon(game, weapon_path, 10, 10, player_character, 'F');
 
     // Create enemy characters
     const char* zombie_path = "assets/images/zombie.png";
     
     auto zombie_1 = create_enemy(game, zombie_path, 10, 200);
-    auto zombie_weapon_1 = create_weapon(game, weapon_path, 10, 10, zombie_1);
+    auto zombie_weapon_1 = create_weapon(game, weapon_path, 10, 10, zombie_1, 'E');
 
     auto zombie_2 = create_enemy(game, zombie_path, 300, 400);
-    auto zombie_weapon_2 = create_weapon(game, weapon_path, 10, 10, zombie_2);
+    auto zombie_weapon_2 = create_weapon(game, weapon_path, 10, 10, zombie_2, 'E');
 
     const char* item_path = "assets/images/explosion-rays.png";
     auto item_1 = create_item(game, item_path, 350, 450, "EXPLOSION_RAY");
@@ -44,20 +117,50 @@ int main(int argc, char* argv[])
     const char* skull_path3 = "assets/images/undead_tileset/PNG/Animation6.png";
     auto skull_3 = create_scenery_animated(game, skull_path3, 6, 3, 860, 520, 0);
 
+    Uint32 run_start = SDL_GetTicks();
+
     while(game.is_running()) 
     {
+        if (options.max_frames > 0 && game.get_clock().frame >= options.max_frames) {
+            break;
+        }
+
         Uint32 frame_start = SDL_GetTicks();
 
         game.read_input();
+        if (!game.is_running()) {
+            break;
+        }
         game.update();
         game.render();
 
+        // Headless runs go back to back as fast as they can
+        if (game.is_headless()) {
+            continue;
+        }
+
         Uint32 frame_time = SDL_GetTicks() - frame_start;
 
         if (frame_delay > frame_time) {
             SDL_Delay(frame_delay - frame_time);
         }
     }
+
+    if (!game.is_headless()) {
+        game.get_texture_cache().report(std::cout);
+    }
+
+    if (options.profile) {
+        game.get_profiler().report(std::cout);
+    }
+    if (options.trace_path && !game.get_profiler().export_chrome_trace(options.trace_path)) {
+        std::cerr << "Error: Could not write trace " << options.trace_path << '\n';
+    }
+
+    if (game.is_headless() || game.get_clock().fixed_step) {
+        std::cout << "Simulated " << game.get_clock().frame << " frames in " << (SDL_GetTicks() - run_start) << " ms"
+                  << " -- checksum: " << std::hex << registry_checksum(game.get_registry()) << std::dec << '\n';
+    }
     
     return 0;
 }
\ No newline at end of file
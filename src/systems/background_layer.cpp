@@ -0,0 +1,214 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <entt/entt.hpp>
+
+#include <SDL2/SDL.h>
+
+#include "../components/tilemap.h"
+#include "../config/game_config.h"
+#include "sprite_batch.cpp"
+
+// The tilemap baked into render target textures, one per chunk of tiles.
+// A chunk is only redrawn from its tiles when something marks it dirty, otherwise the
+// background costs one copy per visible chunk a frame. A tilemap being added, removed or
+// patched (reg.patch<tilemap_component>()) redraws everything, code that changes a few
+// tiles can call invalidate_rect() instead. If the renderer has no render targets the
+// tiles in view are drawn directly every frame like before.
+struct background_layer
+{
+    static constexpr int chunk_tiles = 16; // Chunk width/height in grid cells
+
+    struct chunk {
+        SDL_Texture* target = nullptr;
+        bool dirty = true;
+    };
+
+    int chunk_width = 0;
+    int chunk_height = 0;
+    int columns = 0; // Chunks across
+    int rows = 0;    // Chunks down
+    std::vector<chunk> chunks;
+    bool targets_supported = true;
+
+    ~background_layer()
+    {
+        clear();
+    }
+
+    // World size in grid cells
+    void resize(int map_columns, int map_rows)
+    {
+        clear();
+        chunk_width = GameConfig::instance().grid_cell_width * chunk_tiles;
+        chunk_height = GameConfig::instance().grid_cell_height * chunk_tiles;
+        columns = std::max((map_columns + chunk_tiles - 1) / chunk_tiles, 1);
+        rows = std::max((map_rows + chunk_tiles - 1) / chunk_tiles, 1);
+        chunks.assign(columns * rows, chunk{});
+    }
+
+    void connect(entt::registry& reg)
+    {
+        reg.on_construct<tilemap_component>().connect<&background_layer::on_tilemap_changed>(*this);
+        reg.on_destroy<tilemap_component>().connect<&background_layer::on_tilemap_changed>(*this);
+        reg.on_update<tilemap_component>().connect<&background_layer::on_tilemap_changed>(*this);
+    }
+
+    void on_tilemap_changed(entt::registry&, entt::entity)
+    {
+        invalidate_all();
+    }
+
+    void invalidate_rect(const SDL_Rect& area)
+    {
+        if (chunks.empty()) {
+            return;
+        }
+        const auto [first_x, last_x, first_y, last_y] = chunk_range(area);
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                chunks[y * columns + x].dirty = true;
+            }
+        }
+    }
+
+    // Render targets lose their contents when the device is reset
+    void invalidate_all()
+    {
+        for (chunk& baked : chunks) {
+            baked.dirty = true;
+        }
+    }
+
+    // Draws the part of the background inside view, view being in world pixels
+    void render(entt::registry& reg, SDL_Renderer* renderer, sprite_batch& batch, const SDL_Rect& view)
+    {
+        if (!targets_supported || chunks.empty()) {
+            reg.view<tilemap_component>().each([&](tilemap_component &tilemap) {
+                add_tiles(tilemap, batch, view, view.x, view.y);
+            });
+            batch.flush(renderer);
+            return;
+        }
+
+        const auto [first_x, last_x, first_y, last_y] = chunk_range(view);
+        bake_dirty(reg, renderer, batch, first_x, last_x, first_y, last_y);
+        if (!targets_supported) {
+            render(reg, renderer, batch, view);
+            return;
+        }
+
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                const SDL_Rect dst{x * chunk_width - view.x, y * chunk_height - view.y, chunk_width, chunk_height};
+                SDL_RenderCopy(renderer, chunks[y * columns + x].target, nullptr, &dst);
+            }
+        }
+    }
+
+    // Frees the render targets, must run before the renderer is destroyed
+    void clear()
+    {
+        for (chunk& baked : chunks) {
+            if (baked.target) {
+                SDL_DestroyTexture(baked.target);
+                baked.target = nullptr;
+            }
+            baked.dirty = true;
+        }
+    }
+
+private:
+    static SDL_Rect shifted(const SDL_Rect& rect, int dx, int dy)
+    {
+        return SDL_Rect{rect.x + dx, rect.y + dy, rect.w, rect.h};
+    }
+
+    // Inclusive chunk columns/rows overlapping area, clamped to the layer
+    std::tuple<int, int, int, int> chunk_range(const SDL_Rect& area) const
+    {
+        const int first_x = std::clamp(area.x / chunk_width, 0, columns - 1);
+        const int last_x = std::clamp((area.x + std::max(area.w, 1) - 1) / chunk_width, 0, columns - 1);
+        const int first_y = std::clamp(area.y / chunk_height, 0, rows - 1);
+        const int last_y = std::clamp((area.y + std::max(area.h, 1) - 1) / chunk_height, 0, rows - 1);
+        return {first_x, last_x, first_y, last_y};
+    }
+
+    // Adds the tiles overlapping area, layer by layer, drawn offset by (-origin_x, -origin_y)
+    static void add_tiles(const tilemap_component& tilemap, sprite_batch& batch, const SDL_Rect& area, int origin_x, int origin_y)
+    {
+        if (tilemap.tile_width <= 0 || tilemap.tile_height <= 0) {
+            return;
+        }
+        const int first_col = std::max(area.x / tilemap.tile_width, 0);
+        const int first_row = std::max(area.y / tilemap.tile_height, 0);
+        const int last_col = std::min((area.x + area.w - 1) / tilemap.tile_width, tilemap.columns - 1);
+        const int last_row = std::min((area.y + area.h - 1) / tilemap.tile_height, tilemap.rows - 1);
+        for (int layer = 0; layer < tilemap.layers; ++layer) {
+            for (int row = first_row; row <= last_row; ++row) {
+                for (int col = first_col; col <= last_col; ++col) {
+                    const std::uint16_t tile = tilemap.at(layer, col, row);
+                    if (tile == 0 || tile >= tilemap.palette.size()) {
+                        continue;
+                    }
+                    const tile_type& type = tilemap.palette[tile];
+                    batch.add(type.texture, type.src, shifted(tilemap.cell_rect(col, row), -origin_x, -origin_y));
+                }
+            }
+        }
+    }
+
+    // Redraws the dirty chunks in range from the tiles under them
+    void bake_dirty(entt::registry& reg, SDL_Renderer* renderer, sprite_batch& batch, int first_x, int last_x, int first_y, int last_y)
+    {
+        bool any_dirty = false;
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                chunk& baked = chunks[y * columns + x];
+                if (!baked.target) {
+                    baked.target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, chunk_width, chunk_height);
+                    if (!baked.target) {
+                        SDL_Log("Background render targets unavailable, drawing tiles directly: %s", SDL_GetError());
+                        targets_supported = false;
+                        clear();
+                        return;
+                    }
+                    SDL_SetTextureBlendMode(baked.target, SDL_BLENDMODE_BLEND);
+                    baked.dirty = true;
+                }
+                any_dirty = any_dirty || baked.dirty;
+            }
+        }
+        if (!any_dirty) {
+            return;
+        }
+
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                const int index = y * columns + x;
+                if (!chunks[index].dirty) {
+                    continue;
+                }
+                const SDL_Rect area{x * chunk_width, y * chunk_height, chunk_width, chunk_height};
+                reg.view<tilemap_component>().each([&](tilemap_component &tilemap) {
+                    add_tiles(tilemap, batch, area, area.x, area.y);
+                });
+                SDL_SetRenderTarget(renderer, chunks[index].target);
+                SDL_RenderClear(renderer);
+                batch.flush(renderer);
+                chunks[index].dirty = false;
+            }
+        }
+
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+    }
+};
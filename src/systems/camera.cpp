@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+
+#include "../components/camera.h"
+#include "../components/transform.h"
+#include "../components/player.h"
+#include "../config/game_config.h"
+
+#include <entt/entt.hpp>
+
+struct camera_system 
+{
+    int world_width = 0;
+    int world_height = 0;
+
+    // World size in grid cells
+    void resize(int map_columns, int map_rows)
+    {
+        world_width = map_columns * GameConfig::instance().grid_cell_width;
+        world_height = map_rows * GameConfig::instance().grid_cell_height;
+    }
+
+    void update(entt::registry& reg)
+    {
+        // The first update makes a camera if the world has none
+        bool has_camera = false;
+        reg.view<camera_component>().each([&](camera_component &) { has_camera = true; });
+        if (!has_camera) {
+            const SDL_Rect screen{0, 0, static_cast<int>(GameConfig::instance().screen_width), static_cast<int>(GameConfig::instance().screen_height)};
+            reg.emplace<camera_component>(reg.create(), screen);
+        }
+
+        auto view_camera = reg.view<camera_component>();
+        view_camera.each([&](camera_component &camera) {
+            if (!reg.valid(camera.target) || !reg.all_of<transform_component>(camera.target)) {
+                camera.target = entt::null;
+                reg.view<player_component, transform_component>().each([&](entt::entity player, transform_component &) {
+                    if (camera.target == entt::null) {
+                        camera.target = player;
+                    }
+                });
+            }
+            if (camera.target == entt::null) {
+                return; // Nobody to follow, stay put
+            }
+
+            // Centre on the target, never showing past the edge of the world
+            const auto &transform = reg.get<transform_component>(camera.target);
+            camera.view.x = transform.pos_x + GameConfig::instance().grid_cell_width / 2 - camera.view.w / 2;
+            camera.view.y = transform.pos_y + GameConfig::instance().grid_cell_height / 2 - camera.view.h / 2;
+            camera.view.x = std::clamp(camera.view.x, 0, std::max(world_width - camera.view.w, 0));
+            camera.view.y = std::clamp(camera.view.y, 0, std::max(world_height - camera.view.h, 0));
+        });
+    }
+
+    // What the first camera sees, the top left of the world before there is one
+    SDL_Rect get_view(entt::registry& reg) const
+    {
+        SDL_Rect view{0, 0, static_cast<int>(GameConfig::instance().screen_width), static_cast<int>(GameConfig::instance().screen_height)};
+        bool found = false;
+        reg.view<camera_component>().each([&](camera_component &camera) {
+            if (!found) {
+                view = camera.view;
+                found = true;
+            }
+        });
+        return view;
+    }
+
+    static bool overlaps(const SDL_Rect& a, const SDL_Rect& b)
+    {
+        return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
+};
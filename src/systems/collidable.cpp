@@ -1,14 +1,138 @@
 #pragma once
 
-struct collidable_system 
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+struct collidable_system
 {
     bool checkCollision(
-        int src_x, int src_y, int src_width, int src_height, 
+        int src_x, int src_y, int src_width, int src_height,
         int tgt_x, int tgt_y, int tgt_width, int tgt_height
     ) {
-        return  src_x < tgt_x + tgt_width && 
+        return  src_x < tgt_x + tgt_width &&
                 src_x + src_width > tgt_x &&
-                src_y < tgt_y + tgt_height && 
+                src_y < tgt_y + tgt_height &&
                 src_y + src_height > tgt_y;
     }
-};
\ No newline at end of file
+};
+
+struct aabb { int x, y, w, h; };
+
+// Candidate rectangles stored as separate x/y/w/h arrays so one box can be tested
+// against several of them per instruction: 8 at a time with AVX2, 4 with SSE2, one at a
+// time otherwise. Same test as collidable_system::checkCollision.
+struct aabb_batch
+{
+    std::vector<int> x, y, w, h;
+
+    std::size_t size() const { return x.size(); }
+
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        w.clear();
+        h.clear();
+    }
+
+    void add(int box_x, int box_y, int box_w, int box_h)
+    {
+        x.push_back(box_x);
+        y.push_back(box_y);
+        w.push_back(box_w);
+        h.push_back(box_h);
+    }
+
+    // Index of the lowest set bit, bits must not be 0
+    static int lowest_bit(std::uint64_t bits)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        int index = 0;
+        while (!(bits & 1u)) {
+            bits >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    static bool test_bit(const std::vector<std::uint64_t>& masks, std::size_t index)
+    {
+        return (masks[index / 64] >> (index % 64)) & 1u;
+    }
+
+    // Bit i of masks[q] is set when queries[q] overlaps candidate i. Testing several boxes in one
+    // pass loads each candidate once.
+    template <std::size_t N>
+    void overlaps(const std::array<aabb, N>& queries, std::array<std::vector<std::uint64_t>, N>& masks) const
+    {
+        const std::size_t count = size();
+        for (auto& mask : masks) {
+            mask.assign((count + 63) / 64, 0);
+        }
+        std::size_t i = 0;
+
+#if defined(__AVX2__)
+        __m256i src_x[N], src_right[N], src_y[N], src_bottom[N];
+        for (std::size_t q = 0; q < N; ++q) {
+            src_x[q] = _mm256_set1_epi32(queries[q].x);
+            src_right[q] = _mm256_set1_epi32(queries[q].x + queries[q].w);
+            src_y[q] = _mm256_set1_epi32(queries[q].y);
+            src_bottom[q] = _mm256_set1_epi32(queries[q].y + queries[q].h);
+        }
+        for (; i + 8 <= count; i += 8) {
+            const __m256i tgt_x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x[i]));
+            const __m256i tgt_y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&y[i]));
+            const __m256i tgt_right = _mm256_add_epi32(tgt_x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&w[i])));
+            const __m256i tgt_bottom = _mm256_add_epi32(tgt_y, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&h[i])));
+            for (std::size_t q = 0; q < N; ++q) {
+                __m256i hit = _mm256_cmpgt_epi32(tgt_right, src_x[q]);
+                hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(src_right[q], tgt_x));
+                hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(tgt_bottom, src_y[q]));
+                hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(src_bottom[q], tgt_y));
+                const std::uint64_t bits = static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+                masks[q][i / 64] |= bits << (i % 64);
+            }
+        }
+#elif defined(__SSE2__)
+        __m128i src_x[N], src_right[N], src_y[N], src_bottom[N];
+        for (std::size_t q = 0; q < N; ++q) {
+            src_x[q] = _mm_set1_epi32(queries[q].x);
+            src_right[q] = _mm_set1_epi32(queries[q].x + queries[q].w);
+            src_y[q] = _mm_set1_epi32(queries[q].y);
+            src_bottom[q] = _mm_set1_epi32(queries[q].y + queries[q].h);
+        }
+        for (; i + 4 <= count; i += 4) {
+            const __m128i tgt_x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i]));
+            const __m128i tgt_y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&y[i]));
+            const __m128i tgt_right = _mm_add_epi32(tgt_x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&w[i])));
+            const __m128i tgt_bottom = _mm_add_epi32(tgt_y, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&h[i])));
+            for (std::size_t q = 0; q < N; ++q) {
+                __m128i hit = _mm_cmpgt_epi32(tgt_right, src_x[q]);
+                hit = _mm_and_si128(hit, _mm_cmpgt_epi32(src_right[q], tgt_x));
+                hit = _mm_and_si128(hit, _mm_cmpgt_epi32(tgt_bottom, src_y[q]));
+                hit = _mm_and_si128(hit, _mm_cmpgt_epi32(src_bottom[q], tgt_y));
+                const std::uint64_t bits = static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(hit)));
+                masks[q][i / 64] |= bits << (i % 64);
+            }
+        }
+#endif
+
+        for (; i < count; ++i) {
+            for (std::size_t q = 0; q < N; ++q) {
+                const aabb& box = queries[q];
+                const bool hit = box.x < x[i] + w[i] && box.x + box.w > x[i] && box.y < y[i] + h[i] && box.y + box.h > y[i];
+                masks[q][i / 64] |= static_cast<std::uint64_t>(hit) << (i % 64);
+            }
+        }
+    }
+};
@@ -4,12 +4,15 @@
 #include <vector>
 #include <memory>
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 #include <queue>
+#include <tuple>
 #include <string>
+#include <limits>
+#include <utility>
 #include <fstream> 
 #include <algorithm>
-#include <unordered_map>
 
 #include <entt/entt.hpp>
 
@@ -17,277 +20,546 @@
 #include "../components/transform.h"
 #include "../components/collidable.h"
 #include "../components/weapon.h"
-#include "../components/render_layer.h"
+#include "../components/tilemap.h"
 #include "../components/collision.h"
+#include "../config/game_config.h"
 
 #include "collidable.cpp"
+#include "spatial_grid.cpp"
+#include "../world/scheduler.hpp"
+#include "../world/collision_events.hpp"
 
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator() (const std::pair<T1, T2>& pair) const {
-        return std::hash<T1>()(pair.first) ^ std::hash<T2>()(pair.second);
+struct collision_system 
+{
+    // Dynamic grid map - rebuilt every frame into the same storage, awake movers only
+    spatial_grid dynamic_grid_map;
+
+    // Sleeping grid map - visible movers that have stood still for sleep_after_frames
+    // frames. They go in when they fall asleep and come out when they wake or go.
+    incremental_grid sleeping_grid_map;
+
+    static constexpr int sleep_after_frames = 20;
+
+    // What a collidable with a transform looked like last frame, by entity index
+    struct activity {
+        entt::entity entity = entt::null;
+        SDL_Rect dst{0, 0, 0, 0};
+        bool visible = false;
+        int idle_frames = 0;
+        bool awake = false;    // In awake_movers, checked every frame
+        std::uint32_t checked_on_update = 0; // So a mover in awake_movers twice is checked once
+        bool sleeping = false; // Not checked until its sprite is patched, in sleeping_grid_map if visible
+    };
+    std::vector<activity> activities;
+    std::vector<entt::entity> awake_movers; // Collidables with a transform that are not sleeping
+    std::vector<entt::entity> woken_movers; // New or patched since the last update, may repeat
+    bool rescan = true;                     // Everything is woken from the registry on the next update
+    std::uint32_t update_count = 0;
+
+    // Sizes the grids to cover the loaded map and at least the screen
+    void resize(int num_columns, int num_rows) {
+        const int columns = std::max(num_columns, GameConfig::instance().num_columns);
+        const int rows = std::max(num_rows, GameConfig::instance().num_rows);
+        dynamic_grid_map.resize(columns, rows);
+        sleeping_grid_map.resize(columns, rows);
+        rescan = true;
     }
-};
 
+    // Sleepers are only looked at again when their sprite is patched. Systems that move a sprite
+    // or show or hide it patch it when it changes (and write sprite_component, so the scheduler
+    // never runs them alongside update() or each other).
+    void connect(entt::registry& reg)
+    {
+        reg.on_construct<sprite_component>().connect<&collision_system::on_mover_constructed>(*this);
+        reg.on_construct<transform_component>().connect<&collision_system::on_mover_constructed>(*this);
+        reg.on_construct<collidable_component>().connect<&collision_system::on_mover_constructed>(*this);
+        reg.on_update<sprite_component>().connect<&collision_system::on_sprite_patched>(*this);
+        reg.on_destroy<sprite_component>().connect<&collision_system::on_mover_destroyed>(*this);
+        reg.on_destroy<transform_component>().connect<&collision_system::on_mover_destroyed>(*this);
+        reg.on_destroy<collidable_component>().connect<&collision_system::on_mover_destroyed>(*this);
+    }
 
-using GridMap = std::unordered_map<std::pair<int, int>, std::vector<entt::entity>, pair_hash>;
+    void on_mover_constructed(entt::registry&, entt::entity entity)
+    {
+        woken_movers.push_back(entity);
+    }
 
-template <typename ProcessEntityFunc>
-void process_grid_cell(const GridMap& map, int grid_x, int grid_y, ProcessEntityFunc&& process_entity) {
-    auto it = map.find({grid_x, grid_y});
-    if (it != map.end()) {
-        for (entt::entity entity : it->second) {
-            process_entity(entity);
+    void on_sprite_patched(entt::registry&, entt::entity entity)
+    {
+        const std::size_t index = entt::to_entity(entity);
+        if (index < activities.size() && activities[index].entity == entity && activities[index].sleeping) {
+            woken_movers.push_back(entity);
         }
     }
-}
-
-void check_collisions (
-    collidable_system &s_collidable, 
-    int &entity_proposed_x, 
-    int &entity_proposed_y,
-    const sprite_component &sprite_entity, 
-    transform_component &transform_entity, 
-    entt::entity &entt_target, 
-    const sprite_component &sprite_target, 
-    const collidable_component &collidable_target,
-    bool &collision_detected, 
-    bool &x_collision, 
-    bool &y_collision, 
-    bool &all_x_collisions, 
-    bool &all_y_collisions, 
-    collision_detection_component &collision_entity,
-    int entity_proposed_min_x,
-    int entity_proposed_min_y,
-    int sign_x,
-    int sign_y
-) 
-{
-    // std::cout << "Check Collison Between: (" << sprite_entity.label << " and " << sprite_target.label << ")" << "\n";
-    // std::cout << "SOURCE: (" << entity_proposed_x << "," << entity_proposed_y << ") - (" << sprite_entity.dst.w << "," << sprite_entity.dst.h << ") TARGET: (" << sprite_target.dst.x << "," << sprite_target.dst.y << ") - (" << sprite_target.dst.w << "," << sprite_target.dst.h << ")" << "\n";
-    if (s_collidable.checkCollision(
-        entity_proposed_x, entity_proposed_y, sprite_entity.dst.w, sprite_entity.dst.h, 
-        sprite_target.dst.x, sprite_target.dst.y, sprite_target.dst.w, sprite_target.dst.h))
+
+    void on_mover_destroyed(entt::registry&, entt::entity entity)
     {
-        transform_entity.vel_x = sign_x;
-        transform_entity.vel_y = sign_y;
+        const std::size_t index = entt::to_entity(entity);
+        if (index < activities.size() && activities[index].entity == entity) {
+            forget(activities[index]);
+        }
+    }
 
-        if (s_collidable.checkCollision(
-            entity_proposed_min_x, entity_proposed_min_y, sprite_entity.dst.w, sprite_entity.dst.h, 
-            sprite_target.dst.x, sprite_target.dst.y, sprite_target.dst.w, sprite_target.dst.h))
-        {
-        // std::cout << "Collison Between: (" << sprite_entity.label << " and " << sprite_target.label << ")" << "\n";
-        // Add to colliding_entity collided list if visible
-        
-            if (sprite_target.visible) {
-                collision_entity.collided_entities.push_back(entt_target);       
+    // What the narrow phase worked out for one entity, applied after all workers finish
+    struct narrow_phase_result {
+        int vel_x, vel_y;
+        std::uint32_t thread;           // Whose scratch entry holds its collisions
+        std::uint32_t first_collided;
+        std::uint32_t collided_count;
+    };
+
+    system_scheduler* scheduler = nullptr; // Splits the narrow phase across its threads when set
+    std::vector<entt::entity> narrow_phase_entities;
+    std::vector<narrow_phase_result> narrow_phase_results;
+
+    struct candidate {
+        entt::entity entity;
+        bool visible;
+        bool blocks; // collidable_component::block_movement, only used by CollisionMode::Swept
+    };
+
+    // Views the narrow phase reads, made once per update instead of once per entity or cell
+    struct narrow_phase_views {
+        decltype(std::declval<entt::registry&>().group<sprite_component, transform_component>()) movers;
+        decltype(std::declval<entt::registry&>().view<sprite_component, collidable_component>()) collidables;
+        decltype(std::declval<entt::registry&>().view<weapon_component>()) weapons;
+        const tilemap_component* tilemap; // Walls, may be null
+        entt::entity tilemap_entity;      // What a wall contact is reported as
+    };
+
+    // Per thread working space for narrow_phase, kept between frames so it stops allocating
+    struct narrow_phase_scratch {
+        aabb_batch boxes;
+        std::vector<candidate> candidates;
+        std::vector<std::uint32_t> seen; // Per entity index, the stamp of the last query that gathered it
+        std::uint32_t stamp = 0;
+        std::array<std::vector<std::uint64_t>, 4> hits; // Bitmasks over candidates, see narrow_phase
+        std::vector<std::uint8_t> touched; // Per candidate, for CollisionMode::Swept
+        std::vector<entt::entity> collided;
+    };
+    std::vector<narrow_phase_scratch> scratch; // One per thread
+
+    // What every collision detecting entity touched this frame and how that changed since the last
+    collision_events events;
+    std::vector<std::pair<entt::entity, entt::entity>> touching;
+
+    void update(entt::registry& reg) {
+        update_count += 1;
+        auto view_dynamic_collidables = reg.view<sprite_component, transform_component, collidable_component>();
+        if (rescan) {
+            for (activity& state : activities) {
+                state = activity{};
             }
-            
-            // Check separately for x and y collisions if moving diagonally
-            if (transform_entity.vel_x != 0 && transform_entity.vel_y != 0) {
-                x_collision = s_collidable.checkCollision(
-                    entity_proposed_min_x, transform_entity.pos_y, sprite_entity.dst.w, sprite_entity.dst.h, 
-                    sprite_target.dst.x, sprite_target.dst.y, sprite_target.dst.w, sprite_target.dst.h
-                );
-                y_collision = s_collidable.checkCollision(
-                    transform_entity.pos_x, entity_proposed_min_y, sprite_entity.dst.w, sprite_entity.dst.h, 
-                    sprite_target.dst.x, sprite_target.dst.y, sprite_target.dst.w, sprite_target.dst.h
-                );
+            sleeping_grid_map.clear();
+            awake_movers.clear();
+            woken_movers.clear();
+            for (entt::entity entity : view_dynamic_collidables) {
+                woken_movers.push_back(entity);
             }
-            collision_detected = true;
+            rescan = false;
+        }
 
-            if (all_x_collisions || x_collision) {
-                all_x_collisions = true;
+        // New and patched movers join the awake ones, leaving the sleeping grid if they were in it
+        for (entt::entity entity : woken_movers) {
+            if (!reg.valid(entity) || !view_dynamic_collidables.contains(entity)) {
+                continue;
+            }
+            activity& state = activity_of(entity);
+            if (!state.awake) {
+                forget(state);
+                state.entity = entity;
+                state.awake = true;
+                awake_movers.push_back(entity);
             }
+        }
+        woken_movers.clear();
 
-            if (all_y_collisions || y_collision) {
-                all_y_collisions = true;
+        // Populate grid_map with the awake dynamic entities. Anything that has not moved for a while
+        // falls asleep: it goes to the sleeping grid if it is visible and to neither grid if it is
+        // not (sheathed weapons), and stops being checked until its sprite is patched.
+        dynamic_grid_map.begin_build();
+        std::size_t still_awake = 0;
+        for (entt::entity entity : awake_movers) {
+            const std::size_t index = entt::to_entity(entity);
+            if (activities[index].entity != entity || !activities[index].awake || activities[index].checked_on_update == update_count) {
+                continue; // Gone since it was woken, or already checked
             }
+            activity& state = activities[index];
+            state.checked_on_update = update_count;
+            const auto [sprite, transform] = view_dynamic_collidables.get<sprite_component, transform_component>(entity);
+            const bool moved = transform.vel_x != 0 || transform.vel_y != 0 || transform.move_x != 0 || transform.move_y != 0 || sprite.visible != state.visible
+                || sprite.dst.x != state.dst.x || sprite.dst.y != state.dst.y || sprite.dst.w != state.dst.w || sprite.dst.h != state.dst.h;
+            state.dst = sprite.dst;
+            state.visible = sprite.visible;
+            state.idle_frames = moved ? 0 : std::min(state.idle_frames + 1, sleep_after_frames);
+
+            const auto [first_x, first_y, last_x, last_y] = covered_cells(sprite.dst.x, sprite.dst.y, sprite.dst.w, sprite.dst.h);
+            if (state.idle_frames >= sleep_after_frames) {
+                state.awake = false;
+                state.sleeping = true;
+                if (sprite.visible) {
+                    sleeping_grid_map.add(entity, first_x, first_y, last_x, last_y);
+                }
+                continue;
+            }
+            awake_movers[still_awake++] = entity;
+            if (sprite.visible) {
+                dynamic_grid_map.add(entity, first_x, first_y, last_x, last_y);
+            }
+        }
+        awake_movers.resize(still_awake);
+        dynamic_grid_map.end_build();
+
+        // Loop through entities that can detect collisions (eg players, enemies etc...)
+        // Bear in mind that weapons and explosions etc are collidable_components not collision_detection_components
+        auto group_entity = reg.group<sprite_component, transform_component, collision_detection_component>();
+        narrow_phase_entities.clear();
+        group_entity.each([&](entt::entity entity, sprite_component&, transform_component&, collision_detection_component&) {
+            narrow_phase_entities.push_back(entity);
+        });
+
+        // Each entity only reads the grids and sprites, so entities can be checked in any
+        // order on any thread. Results are applied afterwards in view order, which keeps the
+        // outcome identical to checking them one after another.
+        const std::size_t threads = scheduler ? scheduler->thread_count() : 1;
+        scratch.resize(threads);
+        for (auto& buffer : scratch) {
+            buffer.collided.clear();
         }
+        narrow_phase_results.resize(narrow_phase_entities.size());
+
+        narrow_phase_views views{
+            reg.group<sprite_component, transform_component>(),
+            reg.view<sprite_component, collidable_component>(),
+            reg.view<weapon_component>(),
+            nullptr,
+            entt::null
+        };
+        reg.view<tilemap_component>().each([&](entt::entity entity, tilemap_component &tilemap) {
+            views.tilemap = &tilemap;
+            views.tilemap_entity = entity;
+        });
+        auto check_range = [&](std::size_t begin, std::size_t end, std::size_t thread) {
+            for (std::size_t i = begin; i < end; ++i) {
+                narrow_phase_results[i] = narrow_phase(views, narrow_phase_entities[i], scratch[thread]);
+                narrow_phase_results[i].thread = static_cast<std::uint32_t>(thread);
+            }
+        };
+        if (scheduler) {
+            scheduler->parallel_for(narrow_phase_entities.size(), 64, check_range);
+        } else {
+            check_range(0, narrow_phase_entities.size(), 0);
+        }
+
+        touching.clear();
+        for (std::size_t i = 0; i < narrow_phase_entities.size(); ++i) {
+            const narrow_phase_result& result = narrow_phase_results[i];
+            auto& transform_entity = group_entity.get<transform_component>(narrow_phase_entities[i]);
+            transform_entity.vel_x = result.vel_x;
+            transform_entity.vel_y = result.vel_y;
+
+            const auto first = scratch[result.thread].collided.begin() + result.first_collided;
+            for (auto collided = first; collided != first + result.collided_count; ++collided) {
+                touching.emplace_back(narrow_phase_entities[i], *collided);
+            }
+        }
+        events.publish(touching);
     }
-}
-
-void process_by_grid_map (
-    std::unordered_map<std::pair<int, int>, std::vector<entt::entity>, pair_hash> &grid_map,
-    entt::registry& reg,
-    int cell_x,
-    int cell_y,
-    collidable_system& s_collidable,
-    int entity_proposed_x,
-    int entity_proposed_y,
-    const sprite_component& sprite_entity, 
-    transform_component& transform_entity,
-    bool& collision_detected,
-    bool& x_collision,
-    bool& y_collision,
-    bool& all_x_collisions,
-    bool& all_y_collisions,
-    collision_detection_component& collision_entity,
-    entt::entity entity,
-    bool process_static,
-    int entity_proposed_min_x,
-    int entity_proposed_min_y,
-    int sign_x,
-    int sign_y
-) {
-    // TODO - add this to a global thing so we're not writing it on each loop
-    auto view_all_collidables = reg.view<sprite_component, collidable_component>();
-
-    process_grid_cell(grid_map, cell_x, cell_y, [&](entt::entity entt_target) {
-        
-        if (entity == entt_target) return; // Skip self-collision check
-        
-        const sprite_component& sprite_static_target = view_all_collidables.get<sprite_component>(entt_target);
-        const collidable_component& collidable_static_target = view_all_collidables.get<collidable_component>(entt_target);
-
-        // if (process_static) {
-        //     std::cout << "STATIC Entity collidable: (" << sprite_static_target.grid_x << ", " << sprite_static_target.grid_y << ")" << "\n";
-        // } else {
-        //     std::cout << "DYNAMIC Entity collidable: (" << sprite_static_target.grid_x << ", " << sprite_static_target.grid_y << ")" << "\n";
-        // }
-
-        if (!process_static) {
-            auto weapon_target = reg.try_get<weapon_component>(entt_target);
-            if (weapon_target) {
-                // Check if the owner of the weapon is the same as the current entity
-                if (weapon_target->owner_entt == entity) {
-                    return; // Skip self-collision check with own weapon
+
+    // Works out one entity's velocity and appends what it hit to scratch.collided, without writing to the registry.
+    // Every candidate in the cells the move sweeps over is gathered into scratch.boxes first, then the
+    // four boxes the movement rules need are tested against all of them at once. Walking the masks in
+    // gather order applies the same rules as testing one pair at a time.
+    narrow_phase_result narrow_phase(const narrow_phase_views& views, entt::entity entity, narrow_phase_scratch& scratch) const
+    {
+        const sprite_component& sprite_entity = views.movers.get<sprite_component>(entity);
+        const transform_component& transform_entity = views.movers.get<transform_component>(entity);
+        const std::size_t first_collided = scratch.collided.size();
+
+        int entity_proposed_x = transform_entity.pos_x + transform_entity.vel_x;
+        int entity_proposed_y = transform_entity.pos_y + transform_entity.vel_y;
+
+        // these are secondary proposed values assuming we just move 1 pixel instead of vel pixels
+        int sign_x = (transform_entity.vel_x > 0) - (transform_entity.vel_x < 0);
+        int entity_proposed_min_x = transform_entity.pos_x + sign_x;
+        int sign_y = (transform_entity.vel_y > 0) - (transform_entity.vel_y < 0);
+        int entity_proposed_min_y = transform_entity.pos_y + sign_y;
+
+        // Every box tested below lies inside the box swept from the current position to the proposed
+        // one, so only the cells under that can hold something it hits. Targets are in every cell they
+        // cover, so one spanning several of those cells is gathered once.
+        auto [min_cell_x, min_cell_y, max_cell_x, max_cell_y] = covered_cells(
+            std::min(transform_entity.pos_x, entity_proposed_x),
+            std::min(transform_entity.pos_y, entity_proposed_y),
+            std::abs(transform_entity.vel_x) + sprite_entity.dst.w,
+            std::abs(transform_entity.vel_y) + sprite_entity.dst.h
+        );
+        // Nothing is stored outside the grids. When all of it is off them the loops below run zero times.
+        dynamic_grid_map.clip(min_cell_x, min_cell_y, max_cell_x, max_cell_y);
+
+        if (++scratch.stamp == 0) {
+            std::fill(scratch.seen.begin(), scratch.seen.end(), 0);
+            scratch.stamp = 1;
+        }
+        auto first_visit = [&](entt::entity entt_target) {
+            const std::size_t index = entt::to_entity(entt_target);
+            if (index >= scratch.seen.size()) {
+                scratch.seen.resize(index + 1, 0);
+            }
+            if (scratch.seen[index] == scratch.stamp) {
+                return false;
+            }
+            scratch.seen[index] = scratch.stamp;
+            return true;
+        };
+
+        scratch.boxes.clear();
+        scratch.candidates.clear();
+        auto gather = [&](entt::entity entt_target) {
+            const auto [sprite_target, collidable_target] = views.collidables.get<sprite_component, collidable_component>(entt_target);
+            scratch.boxes.add(sprite_target.dst.x, sprite_target.dst.y, sprite_target.dst.w, sprite_target.dst.h);
+            scratch.candidates.push_back({entt_target, sprite_target.visible, collidable_target.block_movement});
+        };
+        auto gather_dynamic = [&](entt::entity entt_target) {
+            if (entity == entt_target || !first_visit(entt_target)) return; // Skip self-collision check
+            if (views.weapons.contains(entt_target) && views.weapons.get<weapon_component>(entt_target).owner_entt == entity) {
+                return; // Skip self-collision check with own weapon
+            }
+            gather(entt_target);
+        };
+        for (int cell_x = min_cell_x; cell_x <= max_cell_x; ++cell_x) {
+            for (int cell_y = min_cell_y; cell_y <= max_cell_y; ++cell_y) {
+                // ============= DYNAMIC entities, awake then sleeping =============
+                dynamic_grid_map.for_each_in_cell(cell_x, cell_y, gather_dynamic);
+                sleeping_grid_map.for_each_in_cell(cell_x, cell_y, gather_dynamic);
+
+                // ============= WALLS, straight from the tilemap =============
+                if (views.tilemap && views.tilemap->blocks(cell_x, cell_y)) {
+                    const SDL_Rect wall = views.tilemap->cell_rect(cell_x, cell_y);
+                    scratch.boxes.add(wall.x, wall.y, wall.w, wall.h);
+                    scratch.candidates.push_back({views.tilemap_entity, true, true});
                 }
             }
         }
-        
-        check_collisions(
-            s_collidable, 
-            entity_proposed_x, 
-            entity_proposed_y, 
-            sprite_entity, 
-            transform_entity, 
-            entt_target, 
-            sprite_static_target,
-            collidable_static_target,                            
-            collision_detected, 
-            x_collision, 
-            y_collision, 
-            all_x_collisions, 
-            all_y_collisions, 
-            collision_entity,
-            entity_proposed_min_x,
-            entity_proposed_min_y,
-            sign_x,
-            sign_y
-        );
-    });
-}
 
+        const int w = sprite_entity.dst.w, h = sprite_entity.dst.h;
+        if (GameConfig::instance().collision_mode == CollisionMode::Swept) {
+            const auto [move_x, move_y] = resolve_swept(
+                aabb{transform_entity.pos_x, transform_entity.pos_y, w, h}, transform_entity.vel_x, transform_entity.vel_y, scratch
+            );
+            return narrow_phase_result{
+                move_x,
+                move_y,
+                0,
+                static_cast<std::uint32_t>(first_collided),
+                static_cast<std::uint32_t>(scratch.collided.size() - first_collided)
+            };
+        }
 
-struct collision_system 
-{
-    // Static grid map - populated once with static objects
-    std::unordered_map<std::pair<int, int>, std::vector<entt::entity>, pair_hash> static_grid_map;
-
-    // Function to initialize static grid map
-    void load_static_entities(entt::registry& reg) {
-        auto view_static = reg.view<sprite_component, collidable_component, background_component>();
-        view_static.each([&](entt::entity entity, sprite_component &sprite, collidable_component &collidable) {
-            std::pair<int, int> cell = { sprite.grid_x, sprite.grid_y };
-            static_grid_map[cell].push_back(entity);
-        });
+        // Proposed move, single pixel step, and the single pixel step along each axis alone
+        scratch.boxes.overlaps<4>({
+            aabb{entity_proposed_x, entity_proposed_y, w, h},
+            aabb{entity_proposed_min_x, entity_proposed_min_y, w, h},
+            aabb{entity_proposed_min_x, transform_entity.pos_y, w, h},
+            aabb{transform_entity.pos_x, entity_proposed_min_y, w, h}
+        }, scratch.hits);
+        const auto& [proposed_hits, min_hits, x_hits, y_hits] = scratch.hits;
+        const bool diagonal = sign_x != 0 && sign_y != 0;
+
+        int vel_x = transform_entity.vel_x, vel_y = transform_entity.vel_y;
+        bool collision_detected = false;
+        bool all_x_collisions = false, all_y_collisions = false;
+        bool x_collision = true, y_collision = true;
+        for (std::size_t word = 0; word < proposed_hits.size(); ++word) {
+            // Touching the proposed box turns the velocity into single pixel steps
+            std::uint64_t hits = proposed_hits[word];
+            if (hits) {
+                vel_x = sign_x;
+                vel_y = sign_y;
+            }
+            // Only candidates the single pixel step also touches count as collisions
+            hits &= min_hits[word];
+            while (hits) {
+                const std::size_t k = word * 64 + aabb_batch::lowest_bit(hits);
+                hits &= hits - 1;
+
+                if (scratch.candidates[k].visible) {
+                    scratch.collided.push_back(scratch.candidates[k].entity);
+                }
+                // Check separately for x and y collisions if moving diagonally
+                if (diagonal) {
+                    x_collision = aabb_batch::test_bit(x_hits, k);
+                    y_collision = aabb_batch::test_bit(y_hits, k);
+                }
+                collision_detected = true;
+                all_x_collisions = all_x_collisions || x_collision;
+                all_y_collisions = all_y_collisions || y_collision;
+            }
+        }
+
+        // Adjust velocity if collision detected
+        if (collision_detected) {
+            if (all_x_collisions) { vel_x = 0; }
+            if (all_y_collisions) { vel_y = 0; }
+        }
+
+        return narrow_phase_result{
+            vel_x,
+            vel_y,
+            0,
+            static_cast<std::uint32_t>(first_collided),
+            static_cast<std::uint32_t>(scratch.collided.size() - first_collided)
+        };
     }
 
-    void update(entt::registry& reg) {
-        // std::cout << "No of Static Entities: " << std::size(static_grid_map) << "\n";
-        collidable_system s_collidable;
-        std::unordered_map<std::pair<int, int>, std::vector<entt::entity>, pair_hash> dynamic_grid_map;
-        
-        // Populate grid_map with dynamic entities
-        auto view_dynamic_collidables = reg.view<sprite_component, transform_component, collidable_component>();
-        view_dynamic_collidables.each([&](entt::entity entity, sprite_component& sprite, transform_component& transform, collidable_component &collidable) {
-            dynamic_grid_map[{sprite.grid_x, sprite.grid_y}].push_back(entity);
-        });
+private:
+    activity& activity_of(entt::entity entity)
+    {
+        const std::size_t index = entt::to_entity(entity);
+        if (index >= activities.size()) {
+            activities.resize(index + 1);
+        }
+        activity& state = activities[index];
+        if (state.entity != entity) {
+            forget(state);
+            state.entity = entity;
+        }
+        return state;
+    }
 
-        // Loop through entities that can detect collisions (eg players, enemies etc...)
-        // Bear in mind that weapons and explosions etc are collidable_components not collision_detection_components
-        auto view_entity = reg.view<sprite_component, transform_component, collision_detection_component>();
-        view_entity.each([&](entt::entity entity, sprite_component& sprite_entity, transform_component& transform_entity, collision_detection_component& collision_entity) {
-            
-            collision_entity.collided_entities.clear(); // Clear out collided stack each frame for each entity
-            int entity_proposed_x = transform_entity.pos_x + transform_entity.vel_x;
-            int entity_proposed_y = transform_entity.pos_y + transform_entity.vel_y;
-
-            // these are secondary proposed values assuming we just move 1 pixel instead of vel pixels
-            int sign_x = (transform_entity.vel_x > 0) - (transform_entity.vel_x < 0);
-            int entity_proposed_min_x = transform_entity.pos_x + sign_x;
-            int sign_y = (transform_entity.vel_y > 0) - (transform_entity.vel_y < 0);
-            int entity_proposed_min_y = transform_entity.pos_y + sign_y;
-
-            bool collision_detected = false;
-            bool all_x_collisions = false, all_y_collisions = false;
-            bool x_collision, y_collision = true;
-
-            // Compute grid range based on entity size and speed
-            const int grid_radius = 2;  // Example: Adjust based on entity speed and size
-            for (int dx = -grid_radius; dx <= grid_radius; ++dx) {
-                for (int dy = -grid_radius; dy <= grid_radius; ++dy) {
-                    int cell_x = sprite_entity.grid_x + dx;
-                    int cell_y = sprite_entity.grid_y + dy;
-
-                    // ============= Process DYNAMIC entities =============
-                    process_by_grid_map (
-                        dynamic_grid_map,
-                        reg,
-                        cell_x,
-                        cell_y,
-                        s_collidable,
-                        entity_proposed_x,
-                        entity_proposed_y,
-                        sprite_entity, 
-                        transform_entity,
-                        collision_detected,
-                        x_collision,
-                        y_collision,
-                        all_x_collisions,
-                        all_y_collisions,
-                        collision_entity,
-                        entity,
-                        false,
-                        entity_proposed_min_x,
-                        entity_proposed_min_y,
-                        sign_x,
-                        sign_y
-                    );
-
-                    // ============= Process STATIC entities =============
-                    process_by_grid_map (
-                        static_grid_map,
-                        reg,
-                        cell_x,
-                        cell_y,
-                        s_collidable,
-                        entity_proposed_x,
-                        entity_proposed_y,
-                        sprite_entity, 
-                        transform_entity,
-                        collision_detected,
-                        x_collision,
-                        y_collision,
-                        all_x_collisions,
-                        all_y_collisions,
-                        collision_entity,
-                        entity,
-                        true,
-                        entity_proposed_min_x,
-                        entity_proposed_min_y,
-                        sign_x,
-                        sign_y
-                    );
+    // Takes a mover out of the sleeping grid if it is there. Left in awake_movers, update()
+    // drops it once it sees awake is no longer set.
+    void forget(activity& state)
+    {
+        if (state.sleeping && state.visible) {
+            const auto [first_x, first_y, last_x, last_y] = covered_cells(state.dst.x, state.dst.y, state.dst.w, state.dst.h);
+            sleeping_grid_map.remove(state.entity, first_x, first_y, last_x, last_y);
+        }
+        state = activity{};
+    }
+
+    // Earliest blocking contact of a sweep. The time is kept as the fraction
+    // time_gap / time_velocity so distances at that time come out exact.
+    struct sweep_result {
+        double time = 1.0;       // Fraction of the move made before touching, 1 when nothing blocks
+        int time_gap = 1;
+        int time_velocity = 1;
+        bool stop_x = false;     // Contact normal, both for a corner
+        bool stop_y = false;
+
+        int distance(int velocity) const
+        {
+            return time < 1.0 ? velocity * time_gap / time_velocity : velocity;
+        }
+    };
+
+    // Times (fractions of the move) at which a box moving along one axis starts and stops
+    // overlapping a target on that axis, and the gap it closes first. False if it never overlaps.
+    static bool sweep_axis(int pos, int size, int velocity, int target, int target_size, double& entry, double& exit, int& gap)
+    {
+        if (velocity == 0) {
+            entry = -std::numeric_limits<double>::infinity();
+            exit = std::numeric_limits<double>::infinity();
+            gap = 0;
+            return pos < target + target_size && pos + size > target;
+        }
+        gap = velocity > 0 ? target - (pos + size) : target + target_size - pos;
+        const int far = velocity > 0 ? target + target_size - pos : target - (pos + size);
+        entry = static_cast<double>(gap) / velocity;
+        exit = static_cast<double>(far) / velocity;
+        return true;
+    }
+
+    // Moves box by (vel_x, vel_y) until the first blocking candidate and marks every candidate
+    // the box touches on the way, blocking or not. Candidates it already overlaps never block,
+    // so anything stuck inside another can still move out.
+    sweep_result sweep(const aabb& box, int vel_x, int vel_y, narrow_phase_scratch& scratch) const
+    {
+        const aabb_batch& targets = scratch.boxes;
+        sweep_result result;
+        if (vel_x != 0 || vel_y != 0) {
+            for (std::size_t k = 0; k < targets.size(); ++k) {
+                double entry_x, exit_x, entry_y, exit_y;
+                int gap_x, gap_y;
+                if (!scratch.candidates[k].blocks
+                    || !sweep_axis(box.x, box.w, vel_x, targets.x[k], targets.w[k], entry_x, exit_x, gap_x)
+                    || !sweep_axis(box.y, box.h, vel_y, targets.y[k], targets.h[k], entry_y, exit_y, gap_y)) {
+                    continue;
                 }
+                const double entry = std::max(entry_x, entry_y);
+                if (entry < 0.0 || entry >= std::min(exit_x, exit_y) || entry > result.time || entry >= 1.0) {
+                    continue;
+                }
+                if (entry < result.time) {
+                    result = sweep_result{};
+                    result.time = entry;
+                }
+                result.stop_x = result.stop_x || entry_x >= entry_y;
+                result.stop_y = result.stop_y || entry_y >= entry_x;
+                result.time_gap = entry_x >= entry_y ? gap_x : gap_y;
+                result.time_velocity = entry_x >= entry_y ? vel_x : vel_y;
             }
+        }
 
-            // Adjust velocity if collision detected
-            if (collision_detected) {
-                if (all_x_collisions) { transform_entity.vel_x = 0; }
-                if (all_y_collisions) { transform_entity.vel_y = 0; }
+        for (std::size_t k = 0; k < targets.size(); ++k) {
+            double entry_x, exit_x, entry_y, exit_y;
+            int gap_x, gap_y;
+            if (sweep_axis(box.x, box.w, vel_x, targets.x[k], targets.w[k], entry_x, exit_x, gap_x)
+                && sweep_axis(box.y, box.h, vel_y, targets.y[k], targets.h[k], entry_y, exit_y, gap_y)) {
+                const double entry = std::max(entry_x, entry_y), exit = std::min(exit_x, exit_y);
+                if (entry < exit && exit > 0.0 && entry <= result.time) {
+                    scratch.touched[k] = 1;
+                }
             }
-        });
+        }
+        return result;
     }
-};
\ No newline at end of file
+
+    // CollisionMode::Swept: moves up to the exact time of impact with the first blocking
+    // candidate, then slides the rest of the way along the surface it hit. Both sweeps use
+    // the candidates already gathered, as the slide stays inside the swept box. Returns the
+    // distance moved, which becomes the velocity for this frame.
+    std::pair<int, int> resolve_swept(const aabb& box, int vel_x, int vel_y, narrow_phase_scratch& scratch) const
+    {
+        scratch.touched.assign(scratch.candidates.size(), 0);
+
+        const sweep_result contact = sweep(box, vel_x, vel_y, scratch);
+        int move_x = contact.distance(vel_x);
+        int move_y = contact.distance(vel_y);
+        if (contact.time < 1.0) {
+            const aabb moved{box.x + move_x, box.y + move_y, box.w, box.h};
+            const int slide_x = contact.stop_x ? 0 : vel_x - move_x;
+            const int slide_y = contact.stop_y ? 0 : vel_y - move_y;
+            const sweep_result slide = sweep(moved, slide_x, slide_y, scratch);
+            move_x += slide.distance(slide_x);
+            move_y += slide.distance(slide_y);
+        }
+
+        for (std::size_t k = 0; k < scratch.candidates.size(); ++k) {
+            if (scratch.touched[k] && scratch.candidates[k].visible) {
+                scratch.collided.push_back(scratch.candidates[k].entity);
+            }
+        }
+        return {move_x, move_y};
+    }
+
+    // Rounds down for negative positions too, so cells left of or above the map stay outside it
+    static int floor_div(int value, int divisor)
+    {
+        return value / divisor - (value % divisor < 0);
+    }
+
+    // First and last grid column/row a rectangle in world pixels covers, which may lie partly
+    // or wholly outside the grids (spatial_grid leaves those cells out)
+    static std::tuple<int, int, int, int> covered_cells(int x, int y, int w, int h)
+    {
+        const int cell_width = GameConfig::instance().grid_cell_width;
+        const int cell_height = GameConfig::instance().grid_cell_height;
+        return {
+            floor_div(x, cell_width),
+            floor_div(y, cell_height),
+            floor_div(x + std::max(w, 1) - 1, cell_width),
+            floor_div(y + std::max(h, 1) - 1, cell_height)
+        };
+    }
+};
@@ -11,47 +11,35 @@
 #include "../components/combat.h"
 #include "../components/damage.h"
 #include "../components/weapon.h"
+#include "../world/collision_events.hpp"
 
 struct combat_system 
 {  
-    // Rewrite this
-    void update(entt::registry& reg)
+    // Damage lands when a character first touches a damaging entity of the other side
+    void update(entt::registry& reg, const collision_events& events)
     {
+        auto view_character_entities = reg.view<collision_detection_component, hitpoints_component>();
         auto view_damaging_entities = reg.view<damage_component>();
 
-        // Loop through Entities that can do damage!
-        auto view_character_entities = reg.view<collision_detection_component, hitpoints_component, transform_component>();
-        view_character_entities.each([&](collision_detection_component &collision_detection, hitpoints_component &hitpoints, transform_component &transform)
-        {
-
-            if (collision_detection.collided_entities.empty()) {
-                return;
-            }
-
-            // loop through the collided entities and check for damaging entities then work out how much damage they do
-            for (const entt::entity collided_entity : collision_detection.collided_entities) {
-
-                    // Only do something if character has collided with a thing that does damage
-                    if (!view_damaging_entities.contains(collided_entity)) { continue; }
-
-                    auto damage_entity = reg.try_get<damage_component>(collided_entity);
-                    
-                    // Only do something if it's not a friendly type
-                    if (damage_entity->type == collision_detection.type) { continue; }
-                    
-                    if (damage_entity && damage_entity->apply_damage) {
-                        hitpoints.damage_taken_this_turn += damage_entity->damage_per_hit;
-                        damage_entity->apply_damage = false;
-                        if (damage_entity->stun) {
-                            if (!hitpoints.stunned) {
-                                hitpoints.stunned = true;
-                                hitpoints.stunned_frames_remaining = hitpoints.stunned_frames;
-                            }
-                        }
+        events.each<damage_component>(collision_event::enter, [&](const collision_event& event) {
+            if (!view_character_entities.contains(event.a)) { return; }
+            auto [collision_detection, hitpoints] = view_character_entities.get<collision_detection_component, hitpoints_component>(event.a);
+            damage_component& damage_entity = view_damaging_entities.get<damage_component>(event.b);
+
+            // Only do something if it's not a friendly type
+            if (damage_entity.type == collision_detection.type) { return; }
+
+            if (damage_entity.apply_damage) {
+                hitpoints.damage_taken_this_turn += damage_entity.damage_per_hit;
+                damage_entity.apply_damage = false;
+                if (damage_entity.stun) {
+                    if (!hitpoints.stunned) {
+                        hitpoints.stunned = true;
+                        hitpoints.stunned_frames_remaining = hitpoints.stunned_frames;
                     }
                 }
             }
-        );        
+        });
     }
 
     void update_character_statuses(entt::registry& reg) {
@@ -71,9 +59,8 @@ struct combat_system
         });
     }
 
-    void update_weapon_states(entt::registry& reg)
+    void update_weapon_states(entt::registry& reg, Uint32 now)
     {
-        Uint32 now = SDL_GetTicks();
 
         auto view_weapon_entities = reg.view<weapon_component, sprite_component, transform_component, damage_component>();
         view_weapon_entities.each([&](entt::entity entity, weapon_component &weapon, sprite_component &sprite, transform_component &transform, damage_component &damage) {
@@ -88,6 +75,8 @@ struct combat_system
                 return;
             }
 
+            const SDL_Rect dst = sprite.dst;
+            const bool visible = sprite.visible;
             auto weapon_owner_sprite = reg.try_get<sprite_component>(weapon.owner_entt);
             auto weapon_owner_transform = reg.try_get<transform_component>(weapon.owner_entt);
 
@@ -137,6 +126,9 @@ struct combat_system
             }
             sprite.dst.x = transform.pos_x;
             sprite.dst.y = transform.pos_y;
+            if (sprite.visible != visible || sprite.dst.x != dst.x || sprite.dst.y != dst.y) {
+                reg.patch<sprite_component>(entity); // Wakes it in collision_system if it sleeps
+            }
         });
     }  
 };
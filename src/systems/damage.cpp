@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <SDL2/SDL.h>
 
 #include "../components/transform.h"
@@ -39,11 +41,16 @@ struct damage_system
         });
     }
 
-    void render_life_bars(entt::registry& registry, SDL_Renderer* renderer) 
+    // Only the entities the sprite system found on screen get a bar, view shifts world to screen
+    void render_life_bars(entt::registry& registry, SDL_Renderer* renderer, const std::vector<entt::entity>& visible, const SDL_Rect& view) 
     {
-        auto view = registry.view<transform_component, hitpoints_component, life_bar_component>();
-        view.each([&](transform_component &transform, hitpoints_component &hitpoints, life_bar_component &life_bar) {
-            
+        for (entt::entity entity : visible) {
+            if (!registry.all_of<transform_component, hitpoints_component, life_bar_component>(entity)) {
+                continue;
+            }
+            auto &transform = registry.get<transform_component>(entity);
+            auto &hitpoints = registry.get<hitpoints_component>(entity);
+            auto &life_bar = registry.get<life_bar_component>(entity);
             
             // Position the life bar above the entity
 
@@ -57,9 +64,10 @@ struct damage_system
             life_bar.color = get_health_color(hitpoints_percent);
 
             // Render the filled portion of the life bar
+            const SDL_Rect bar_on_screen{life_bar.bar_rect.x - view.x, life_bar.bar_rect.y - view.y, life_bar.bar_rect.w, life_bar.bar_rect.h};
             SDL_SetRenderDrawColor(renderer, life_bar.color.r, life_bar.color.g, life_bar.color.b, 255); // Health color
-            SDL_RenderFillRect(renderer, &life_bar.bar_rect);
-        });
+            SDL_RenderFillRect(renderer, &bar_on_screen);
+        }
     }
 
     void render_cooldowns(entt::registry& registry, SDL_Renderer* renderer) 
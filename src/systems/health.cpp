@@ -1,52 +1,86 @@
 #pragma once
 
+#include <vector>
+#include <algorithm>
 #include <SDL2/SDL.h>
 
 #include "../components/health.h"
 #include "../components/item.h"
+#include "../components/weapon.h"
+#include "../world/command_buffer.hpp"
 
 #include <entt/entt.hpp>
 
 
 struct health_system 
 {  
-    void update(entt::registry& reg)
+    command_buffer* commands = nullptr; // Where owned_component changes are recorded
+
+    // Keeps each owner's owned_component in step with the weapons pointing at it
+    void connect(entt::registry& reg, command_buffer& buffer)
     {
-        std::vector<entt::entity> to_destroy;
-        auto view_health = reg.view<hitpoints_component>();
+        commands = &buffer;
+        reg.on_construct<weapon_component>().connect<&health_system::on_weapon_added>(*this);
+        reg.on_destroy<weapon_component>().connect<&health_system::on_weapon_removed>(*this);
+    }
 
-        // Find entities to destroy
-        for (auto entity : view_health)
-        {
-            auto &hitpoints = view_health.get<hitpoints_component>(entity);
-            if (hitpoints.hitpoints <= 0) {
-                to_destroy.push_back(entity);
-            }        
+    void on_weapon_added(entt::registry& reg, entt::entity weapon)
+    {
+        const entt::entity owner = reg.get<weapon_component>(weapon).owner_entt;
+        if (!reg.valid(owner)) {
+            return;
         }
+        // Weapons appear while a flush applies commands, so the owner's list is changed by a
+        // command of its own, applied later in the same flush
+        commands->get_or_emplace<owned_component>(owner, [weapon](owned_component &owned) {
+            owned.owned.push_back(weapon);
+        });
+    }
 
-        // Remove related weapon entities before destroying the main entity
-        auto view_weapons = reg.view<weapon_component>();
-        for (auto entity : to_destroy) 
-        {
-            for (auto weapon : view_weapons) 
-            {
-                auto &weapon_instance = view_weapons.get<weapon_component>(weapon);
-                if (weapon_instance.owner_entt == entity) 
-                {
-                    reg.destroy(weapon); // Destroy the weapon first
-                }
+    void on_weapon_removed(entt::registry& reg, entt::entity weapon)
+    {
+        const entt::entity owner = reg.get<weapon_component>(weapon).owner_entt;
+        if (!reg.valid(owner)) {
+            return;
+        }
+        if (auto owned = reg.try_get<owned_component>(owner)) {
+            auto it = std::find(owned->owned.begin(), owned->owned.end(), weapon);
+            if (it != owned->owned.end()) {
+                *it = owned->owned.back();
+                owned->owned.pop_back();
+            }
+        }
+    }
+
+    // Queues entity and everything it owns, and everything they own, for destruction
+    void destroy_with_owned(entt::registry& reg, entt::entity entity, command_buffer& commands)
+    {
+        if (auto owned = reg.try_get<owned_component>(entity)) {
+            for (auto child : owned->owned) {
+                destroy_with_owned(reg, child, commands);
             }
-            reg.destroy(entity); // Then destroy the owner
         }
+        commands.destroy(entity);
+    }
+
+    // Dead entities go at the next flush of commands, weapons with their owner
+    void update(entt::registry& reg, command_buffer& commands)
+    {
+        auto view_health = reg.view<hitpoints_component>();
+        view_health.each([&](entt::entity entity, hitpoints_component &hitpoints) {
+            if (hitpoints.hitpoints <= 0) {
+                destroy_with_owned(reg, entity, commands);
+            }
+        });
     }
 
-    void update_item_clear_up(entt::registry& reg)
+    void update_item_clear_up(entt::registry& reg, command_buffer& commands)
     {
         auto view_items = reg.view<item_component>();
         view_items.each([&](entt::entity item_entt, item_component &item) {
             if (item.to_destroy) 
             {
-                reg.destroy(item_entt); // Destroy the weapon first
+                commands.destroy(item_entt);
             }
         });
     }
@@ -5,35 +5,28 @@
 #include "../components/player.h"
 #include "../components/collision.h"
 #include "../components/inventory.h"
+#include "../world/collision_events.hpp"
 #include <entt/entt.hpp>
 
 struct item_retrieval_system
 {   
-    void update(entt::registry& reg)
+    // Players pick up an item when they first touch it
+    void update(entt::registry& reg, const collision_events& events)
     {
+        auto view_player_entities = reg.view<inventory_component, player_component>();
         auto view_item_entities = reg.view<item_component>();
-        auto view_player_entities = reg.view<collision_detection_component, inventory_component, player_component>();
 
-        view_player_entities.each([&](collision_detection_component& player_collision_detection, inventory_component& player_inventory)
-        {
-            if (player_collision_detection.collided_entities.empty()) {
+        events.each<item_component>(collision_event::enter, [&](const collision_event& event) {
+            if (!view_player_entities.contains(event.a)) {
                 return;
             }
+            inventory_component& player_inventory = view_player_entities.get<inventory_component>(event.a);
+            item_component& item = view_item_entities.get<item_component>(event.b);
 
-            for (const entt::entity collided_entity : player_collision_detection.collided_entities) {
-                // Check if collided entity is an item
-                if (!view_item_entities.contains(collided_entity)) {
-                    continue;
-                }
-
-                // Access item component
-                item_component& item = reg.get<item_component>(collided_entity);
-
-                // Print item name to console
-                std::cout << "Player picked up item: " << item.item_name << std::endl;
-                player_inventory.items.push_back(item.item_name);
-                item.to_destroy = true;
-            }
-        });        
+            // Print item name to console
+            std::cout << "Player picked up item: " << item.item_name << std::endl;
+            player_inventory.items.push_back(item.item_name);
+            item.to_destroy = true;
+        });
     }
 };
\ No newline at end of file
@@ -1,38 +1,191 @@
 #pragma once
 
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <SDL2/SDL.h>
+#include <algorithm>
+#include <unordered_map>
 
+#include "../../config/game_config.h"
 
-struct performance_logging_system 
+// Frame profiler. Wrap a piece of work in measure() (or hold the scoped_timer from time())
+// and its duration lands in a ring buffer holding the last `capacity` samples. report()
+// prints p50/p95/p99 per name and export_chrome_trace() writes the buffer as Chrome
+// trace-event JSON, which opens in Perfetto or chrome://tracing. Does nothing until
+// enabled. Safe to record from several threads at once.
+struct performance_logging_system
 {
-    Uint32 start_time = 0;   // Holds the time when start() is called
-    bool is_running = false; // Tracks whether the timer is active
-    Uint32 total_ms = 0;
-    Uint32 total_frames = 0;
+    using clock = std::chrono::steady_clock;
 
-    // Starts the timer
-    void start() 
+    struct sample {
+        const char* name;    // Must outlive the profiler, string literals in practice
+        std::int64_t start_ns;
+        std::int64_t duration_ns;
+        std::uint32_t frame;
+        std::uint32_t thread;
+    };
+
+    // Records the time from construction to destruction under name
+    struct scoped_timer {
+        performance_logging_system* profiler;
+        const char* name;
+        clock::time_point start;
+
+        scoped_timer(performance_logging_system* owner, const char* timer_name)
+            : profiler(owner && owner->enabled ? owner : nullptr), name(timer_name), start(profiler ? clock::now() : clock::time_point{}) {}
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+        ~scoped_timer()
+        {
+            if (profiler) {
+                profiler->record(name, start, clock::now());
+            }
+        }
+    };
+
+    static constexpr std::size_t capacity = 1 << 16;
+    static constexpr const char* frame_name = "frame";
+
+    bool enabled = false;
+    std::uint32_t frame = 0;
+
+    void enable()
     {
-        start_time = SDL_GetTicks();
-        is_running = true;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        enabled = true;
+        m_samples.reserve(capacity);
     }
 
-    // Stops the timer and prints the elapsed time
-    void stop() 
+    scoped_timer time(const char* name)
     {
-        if (is_running) 
-        {
-            Uint32 now = SDL_GetTicks();
-            Uint32 elapsed_time = now - start_time;
-            total_ms += elapsed_time;
-            total_frames += 1;
-            std::cout << "Elapsed Time: " << elapsed_time << " ms. Average time: " << total_ms/total_frames << " ms\n";
-            is_running = false;     
-        }
-        else 
+        return scoped_timer(this, name);
+    }
+
+    template <typename Work>
+    void measure(const char* name, Work&& work)
+    {
+        scoped_timer timer(this, name);
+        work();
+    }
+
+    // Brackets one whole frame, which report() checks against the frame budget
+    void begin_frame()
+    {
+        m_frame_start = clock::now();
+    }
+
+    void end_frame()
+    {
+        if (enabled) {
+            record(frame_name, m_frame_start, clock::now());
+        }
+        frame += 1;
+    }
+
+    void record(const char* name, clock::time_point start, clock::time_point end)
+    {
+        const sample recorded{
+            name,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_origin).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+            frame,
+            thread_index()
+        };
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samples.size() < capacity) {
+            m_samples.push_back(recorded);
+        } else {
+            m_samples[m_next] = recorded;
+        }
+        m_next = (m_next + 1) % capacity;
+    }
+
+    // Percentiles per name over what is still in the buffer, slowest p99 first
+    void report(std::ostream& out)
+    {
+        std::unordered_map<const char*, std::vector<std::int64_t>> durations;
         {
-            std::cout << "Error: Timer was not started.\n";
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const sample& recorded : m_samples) {
+                durations[recorded.name].push_back(recorded.duration_ns);
+            }
+        }
+
+        struct row { const char* name; std::size_t count; double p50, p95, p99, max; };
+        std::vector<row> rows;
+        for (auto& [name, values] : durations) {
+            std::sort(values.begin(), values.end());
+            auto percentile = [&](double p) {
+                const std::size_t index = std::min(values.size() - 1, static_cast<std::size_t>(p * values.size()));
+                return values[index] / 1e6;
+            };
+            rows.push_back({name, values.size(), percentile(0.50), percentile(0.95), percentile(0.99), values.back() / 1e6});
+        }
+        std::sort(rows.begin(), rows.end(), [](const row& a, const row& b) { return a.p99 > b.p99; });
+
+        // Only the frames whose samples are still in the buffer, not every frame since startup
+        const int budget_ms = GameConfig::instance().frame_delay;
+        std::size_t frames = 0;
+        std::size_t over_budget = 0;
+        auto frame_durations = durations.find(frame_name);
+        if (frame_durations != durations.end()) {
+            frames = frame_durations->second.size();
+            over_budget = std::count_if(frame_durations->second.begin(), frame_durations->second.end(), [&](std::int64_t ns) { return ns > budget_ms * 1000000ll; });
+        }
+
+        out << "Profile over the last " << frames << " frames (ms), " << over_budget << " of " << frames << " over the " << budget_ms << " ms budget\n";
+        out << std::left << std::setw(54) << "  name" << std::right << std::setw(8) << "count"
+            << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << '\n';
+        out << std::fixed << std::setprecision(3);
+        for (const row& r : rows) {
+            out << "  " << std::left << std::setw(52) << r.name << std::right << std::setw(8) << r.count
+                << std::setw(10) << r.p50 << std::setw(10) << r.p95 << std::setw(10) << r.p99 << std::setw(10) << r.max << '\n';
         }
+        out << std::defaultfloat;
+    }
+
+    // Complete ("X") events in microseconds, one track per thread
+    bool export_chrome_trace(const std::string& path)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << std::fixed << std::setprecision(3);
+        const std::size_t count = m_samples.size();
+        const std::size_t oldest = count < capacity ? 0 : m_next;
+        for (std::size_t i = 0; i < count; ++i) {
+            const sample& recorded = m_samples[(oldest + i) % count];
+            file << (i == 0 ? "" : ",\n")
+                 << "{\"name\":\"" << recorded.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << recorded.thread
+                 << ",\"ts\":" << recorded.start_ns / 1e3 << ",\"dur\":" << recorded.duration_ns / 1e3
+                 << ",\"args\":{\"frame\":" << recorded.frame << "}}";
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<sample> m_samples;
+    std::size_t m_next = 0;
+    clock::time_point m_origin = clock::now();
+    clock::time_point m_frame_start = m_origin;
+
+    // Small stable number per thread for the trace viewer
+    static std::uint32_t thread_index()
+    {
+        static std::atomic<std::uint32_t> next_index{0};
+        thread_local const std::uint32_t index = next_index++;
+        return index;
     }
-};
\ No newline at end of file
+};
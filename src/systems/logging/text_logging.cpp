@@ -10,17 +10,17 @@
 #include "../../components/path_finding.h"
 #include "../../components/targetting.h"
 #include "../../components/render_layer.h"
+#include "../../world/collision_events.hpp"
 
 #include <entt/entt.hpp>
 
 
 struct logging_system 
 {
-    Uint32 last_print_time = SDL_GetTicks();
+    Uint32 last_print_time = 0;
     
-    void update(entt::registry& reg, int log_interval)
+    void update(entt::registry& reg, const collision_events& events, Uint32 now, int log_interval)
     {
-        Uint32 now = SDL_GetTicks();
         Uint32 elapsed_time = now - last_print_time;
         
         if (elapsed_time >= (log_interval * 1000)) {
@@ -31,9 +31,11 @@ struct logging_system
                 << " -- X,Y: (" << player_transform.pos_x << "," << player_transform.pos_y
                 << ") -- Grid X,Y: (" << player_sprite.grid_x << "," << player_sprite.grid_y << ")" << '\n';
 
-                for (const auto& collided_entity : player_collidable.collided_entities) {
-                    std::cout << "Player Collided With: " << static_cast<uint32_t>(collided_entity) << '\n';
-                }
+                events.each(collision_event::touching, [&](const collision_event& event) {
+                    if (event.a == player_entity) {
+                        std::cout << "Player Collided With: " << static_cast<uint32_t>(event.b) << '\n';
+                    }
+                });
 
                 std::cout << "Player Hitpoints: " << player_hitpoints.hitpoints << '\n';
             });
@@ -44,21 +46,15 @@ struct logging_system
             targetting_component &enemy_targetting, hitpoints_component &enemy_hitpoints) 
             {
                 std::cout << "Enemy ID: " << static_cast<uint32_t>(enemy_entity) << '\n'; 
-                std::cout << "Path from (" << enemy_sprite.grid_x << ", " << enemy_sprite.grid_y << ")" << " of size " << std::size(enemy_path_finding.path) << "\n";
+                std::cout << "Path from (" << enemy_sprite.grid_x << ", " << enemy_sprite.grid_y << ")" << " of length " << enemy_path_finding.path_length << "\n";
                 
-                for (const auto& node : enemy_path_finding.path) {
-                    std::cout << "Node at (" << node.grid_x << ", " << node.grid_y << ") with f-cost: " << node.f_cost() << '\n';
+                for (const int cell : enemy_path_finding.path) {
+                    std::cout << "Node at cell " << cell << '\n';
                 }
 
                 std::cout << "Enemy Hitpoints: " << enemy_hitpoints.hitpoints << '\n';
             });
 
-            auto view_static = reg.view<sprite_component, transform_component, background_component>();
-            view_static.each([&](entt::entity static_entity, sprite_component &static_sprite, transform_component &static_transform) 
-            {
-                std::cout << "Static ID: " << static_cast<uint32_t>(static_entity) << "Path from (" << static_sprite.grid_x << ", " << static_sprite.grid_y << ") xy_pos: " << static_sprite.dst.x << ", " << static_sprite.dst.y << "\n";
-            });
-
             // std::cout << entity_proposed_x << "," << transform_entity.pos_y << '\n';
             // std::cout << transform_entity.pos_x << "," << entity_proposed_y << '\n';
             // std::cout << sprite_collidable.dst.x << "," << sprite_collidable.dst.x + sprite_collidable.dst.w << "," << sprite_collidable.dst.y << "," << sprite_collidable.dst.y + sprite_collidable.dst.h << '\n';
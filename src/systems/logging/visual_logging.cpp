@@ -9,7 +9,8 @@
 
 struct visual_logging_system 
 {
-    void render(entt::registry& reg, SDL_Renderer* renderer) {
+    // map_columns is the row stride of the cell indices stored in path_finding_component::path
+    void render(entt::registry& reg, SDL_Renderer* renderer, int map_columns) {
         // Set render color to red for the path nodes
         SDL_SetRenderDrawColor(renderer, 255, 0, 255, 255);
 
@@ -19,11 +20,11 @@ struct visual_logging_system
             path_finding_component& path_finding = view.get<path_finding_component>(entity);
 
             // Iterate over each node in the path
-            for (const Node& node : path_finding.path) {
+            for (const int cell : path_finding.path) {
                 // Define the rectangle position and size based on node's grid coordinates
                 SDL_Rect rect;
-                rect.x = node.grid_x * GameConfig::instance().grid_cell_width;  // Assuming each grid cell is 32x32 pixels
-                rect.y = node.grid_y * GameConfig::instance().grid_cell_height;
+                rect.x = (cell % map_columns) * GameConfig::instance().grid_cell_width;  // Assuming each grid cell is 32x32 pixels
+                rect.y = (cell / map_columns) * GameConfig::instance().grid_cell_height;
                 rect.w = (GameConfig::instance().grid_cell_width / 4);  // Width of each node's visual rectangle
                 rect.h = (GameConfig::instance().grid_cell_height / 4);  // Height of each node's visual rectangle
 
@@ -6,27 +6,23 @@
 #include "../components/player.h"
 #include "../components/combat.h"
 #include "../components/targetting.h"
+#include "../components/input.h"
 
 #include <entt/entt.hpp>
 
 struct movement_system 
 {  
-    void update_players(entt::registry& reg)
+    void update_players(entt::registry& reg, const input_state& input)
     {
-        const Uint8* keys = SDL_GetKeyboardState(NULL);
-
-        // Update movement based on key inputs
+        // Update movement based on this frame's input
         auto view_player = reg.view<transform_component, combat_component, player_component>();
-        view_player.each([&keys, &reg](transform_component &transform, combat_component &combat){
-            // Apply movement based on input
-            if (keys[SDL_SCANCODE_A]) { transform.vel_x = -transform.speed; } 
-            if (keys[SDL_SCANCODE_S]) { transform.vel_y = transform.speed; }
-            if (keys[SDL_SCANCODE_W]) { transform.vel_y = -transform.speed; }
-            if (keys[SDL_SCANCODE_D]) { transform.vel_x = transform.speed; }
-            if (keys[SDL_SCANCODE_L]) { combat.attacking = true; }
-            if (!keys[SDL_SCANCODE_L]) { combat.attacking = false; }
-            if (!keys[SDL_SCANCODE_A] && !keys[SDL_SCANCODE_D]) { transform.vel_x = 0; }
-            if (!keys[SDL_SCANCODE_S] && !keys[SDL_SCANCODE_W]) { transform.vel_y = 0; }    
+        view_player.each([&input](transform_component &transform, combat_component &combat){
+            // Apply movement based on input, right wins over left and up over down
+            const int direction_x = input.right ? 1 : (input.left ? -1 : 0);
+            const int direction_y = input.up ? -1 : (input.down ? 1 : 0);
+            normalise(direction_x, direction_y, transform.speed, transform.move_x, transform.move_y);
+            if (input.attack) { combat.attacking = true; }
+            if (!input.attack) { combat.attacking = false; }
         });
     }
 
@@ -40,9 +36,8 @@ struct movement_system
             int direction_x = aquire_target.target_x - enemy_transform.pos_x;
             int direction_y = aquire_target.target_y - enemy_transform.pos_y;
 
-            // Set velocity to move towards the player using sign-based normalization
-            enemy_transform.vel_x = (direction_x > 0) - (direction_x < 0); // -1, 0, or +1 based on the direction
-            enemy_transform.vel_y = (direction_y > 0) - (direction_y < 0); // -1, 0, or +1 based on the direction
+            // Head straight for the target at the enemy's speed
+            normalise(direction_x, direction_y, enemy_transform.speed, enemy_transform.move_x, enemy_transform.move_y);
         });
     }
 
@@ -51,8 +46,9 @@ struct movement_system
         auto view_transform = reg.view<transform_component>();
         view_transform.each([](transform_component& transform) {
 
-            const int vx = transform.vel_x;
-            const int vy = transform.vel_y;
+            // The velocity rather than this frame's whole pixels, which are 0 on some frames when slow
+            const fixed vx = transform.move_x;
+            const fixed vy = transform.move_y;
 
             if (vx == 0 && vy == 0) {
                 return; // No movement, keep current direction
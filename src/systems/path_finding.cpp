@@ -1,8 +1,10 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
-#include <queue>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
 
 #include "../config/game_config.h"
 #include "../components/sprite.h"
@@ -10,109 +12,329 @@
 #include "../components/path_finding.h"
 #include "../components/collidable.h"
 #include "../components/targetting.h"
+#include "../components/tilemap.h"
+#include "path_search.cpp"
+#include "path_finding_hierarchy.cpp"
 #include <entt/entt.hpp>
 
+// Distance in cells from every grid cell to one target cell.
+// Built with a single breadth first search per frame and shared by every enemy chasing
+// that target, so each of them can read its next step in O(1).
+struct flow_field
+{
+    entt::entity target_entt = entt::null;
+    int target_index = -1;
+    std::uint32_t built_on_update = 0;
+    std::vector<int> distance;      // -1 when the cell cannot reach the target
+    std::vector<int> frontier;      // BFS queue, kept between builds
+};
+
 struct path_finding_system
 {
-    // Comparison operator for the priority queue
-    struct CompareNode {
-        bool operator()(const Node* a, const Node* b) const {
-            return a->f_cost() > b->f_cost();
+    // Straight and diagonal step costs, scaled so the octile heuristic stays in integers
+    static constexpr int straight_cost = 10;
+    static constexpr int diagonal_cost = 14;
+
+    // Heuristic function for A*, manhattan for 4-way movement and octile for 8-way
+    static int heuristic(int x1, int y1, int x2, int y2, bool diagonals) {
+        const int dx = abs(x1 - x2);
+        const int dy = abs(y1 - y2);
+        if (!diagonals) {
+            return straight_cost * (dx + dy);
+        }
+        return straight_cost * (dx + dy) + (diagonal_cost - 2 * straight_cost) * std::min(dx, dy);
+    }
+
+    int columns = GameConfig::instance().num_columns;
+    int rows = GameConfig::instance().num_rows;
+    std::uint32_t update_count = 0;
+
+    // Search state, reused from frame to frame
+    std::vector<std::uint8_t> blocked_cells;    // wall_cells plus the cells collidables stand on
+    std::vector<std::uint8_t> wall_cells;       // Tilemap walls, only refreshed when a tilemap changes
+    std::vector<std::uint8_t> patched_walls;    // Scratch for refresh_walls
+    std::vector<int> overlaid_cells;            // Cells collidables were marked on last update
+    bool walls_changed = true;
+    std::vector<flow_field> flow_fields;
+    path_search_context search_context;
+    path_hierarchy hierarchy;
+
+    path_finding_system()
+    {
+        resize(columns, rows);
+    }
+
+    void resize(int num_columns, int num_rows)
+    {
+        columns = std::max(num_columns, GameConfig::instance().num_columns);
+        rows = std::max(num_rows, GameConfig::instance().num_rows);
+        blocked_cells.assign(columns * rows, 0);
+        wall_cells.assign(columns * rows, 0);
+        overlaid_cells.clear();
+        search_context.resize(columns, rows);
+        walls_changed = true;
+        hierarchy.built = false;
+    }
+
+    // The hierarchy is built in full when a tilemap arrives or goes. Patches only update the
+    // clusters around the cells whose walls changed, see refresh_walls().
+    void connect(entt::registry& reg)
+    {
+        reg.on_construct<tilemap_component>().connect<&path_finding_system::on_tilemap_loaded>(*this);
+        reg.on_destroy<tilemap_component>().connect<&path_finding_system::on_tilemap_loaded>(*this);
+        reg.on_update<tilemap_component>().connect<&path_finding_system::on_tilemap_patched>(*this);
+    }
+
+    void on_tilemap_loaded(entt::registry&, entt::entity)
+    {
+        walls_changed = true;
+        hierarchy.built = false;
+    }
+
+    void on_tilemap_patched(entt::registry&, entt::entity)
+    {
+        walls_changed = true;
+    }
+
+    // Copies the tilemap's walls into cells, which is columns * rows
+    void mark_walls(entt::registry& reg, std::vector<std::uint8_t>& cells) const
+    {
+        reg.view<tilemap_component>().each([&](tilemap_component &tilemap) {
+            for (int y = 0; y < std::min(rows, tilemap.rows); ++y) {
+                for (int x = 0; x < std::min(columns, tilemap.columns); ++x) {
+                    cells[y * columns + x] |= tilemap.blocked[y * tilemap.columns + x];
+                }
+            }
+        });
+    }
+
+    // Brings wall_cells and blocked_cells up to date with the tilemaps and tells the
+    // hierarchy about every cell that changed. Only runs after a tilemap signal.
+    void refresh_walls(entt::registry& reg)
+    {
+        patched_walls.assign(columns * rows, 0);
+        mark_walls(reg, patched_walls);
+        for (int cell = 0; cell < columns * rows; ++cell) {
+            if (patched_walls[cell] != wall_cells[cell]) {
+                wall_cells[cell] = patched_walls[cell];
+                blocked_cells[cell] = patched_walls[cell];
+                hierarchy.set_wall(cell % columns, cell / columns, patched_walls[cell]);
+            }
+        }
+        walls_changed = false;
+    }
+
+    // Marks the cells collidables stand on, after putting back the walls under last update's
+    // marks, so a frame costs the number of collidables rather than the size of the map
+    void overlay_collidables(entt::registry& reg)
+    {
+        for (int cell : overlaid_cells) {
+            blocked_cells[cell] = wall_cells[cell];
         }
-    };
+        overlaid_cells.clear();
+        auto view_collidable_entities = reg.view<sprite_component, collidable_component>();
+        view_collidable_entities.each([&](sprite_component &sprite, collidable_component &) {
+            const int cell = get_cell(sprite.grid_x, sprite.grid_y);
+            blocked_cells[cell] = 1;
+            overlaid_cells.push_back(cell);
+        });
+    }
+
+    int get_cell(int x, int y) const
+    {
+        return std::clamp(y, 0, rows - 1) * columns + std::clamp(x, 0, columns - 1);
+    }
+
+    // Blocked cells are reached by the search but never expanded, the same rule find_path uses
+    void build_flow_field(flow_field &field)
+    {
+        static const std::array<std::pair<int, int>, 4> neighbor_offsets = {{{0, 1}, {1, 0}, {0, -1}, {-1, 0}}};
+
+        field.distance.assign(columns * rows, -1);
+        field.frontier.clear();
+        field.distance[field.target_index] = 0;
+        field.frontier.push_back(field.target_index);
+
+        for (std::size_t head = 0; head < field.frontier.size(); ++head) {
+            const int cell = field.frontier[head];
+            if (cell != field.target_index && blocked_cells[cell]) {
+                continue;
+            }
+
+            const int cell_x = cell % columns;
+            const int cell_y = cell / columns;
+            for (const auto& [dx, dy] : neighbor_offsets) {
+                const int neighbor_x = cell_x + dx;
+                const int neighbor_y = cell_y + dy;
+                if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= columns || neighbor_y >= rows) {
+                    continue;
+                }
 
-    // Heuristic function for A*
-    static int manhattan_distance(int x1, int y1, int x2, int y2) {
-        return abs(x1 - x2) + abs(y1 - y2);
+                const int neighbor = neighbor_y * columns + neighbor_x;
+                if (field.distance[neighbor] < 0) {
+                    field.distance[neighbor] = field.distance[cell] + 1;
+                    field.frontier.push_back(neighbor);
+                }
+            }
+        }
+        field.built_on_update = update_count;
     }
 
-    inline int get_index(int x, int y) {
-    return y * 100 + x;
+    // Returns the field for this target, building it the first time it is asked for this frame
+    const flow_field& get_flow_field(entt::entity target_entt, const sprite_component &target_sprite)
+    {
+        const int target_index = get_cell(target_sprite.grid_x, target_sprite.grid_y);
+
+        flow_field* field = nullptr;
+        for (flow_field &existing : flow_fields) {
+            if (existing.target_entt == target_entt) {
+                field = &existing;
+                break;
+            }
+        }
+        if (!field) {
+            field = &flow_fields.emplace_back();
+            field->target_entt = target_entt;
+        }
+
+        if (field->built_on_update != update_count || field->target_index != target_index) {
+            field->target_index = target_index;
+            build_flow_field(*field);
+        }
+        return *field;
     }
 
-    // A* algorithm
-    std::vector<Node> find_path(entt::registry& reg, int start_x, int start_y, int target_x, int target_y, std::unordered_set<int> &collidable_positions) {
-        std::priority_queue<Node*, std::vector<Node*>, CompareNode> open_set;
-        std::unordered_map<int, Node> all_nodes;
+    // Reads the next cell towards the target, returns the path length (0 when unreachable)
+    int read_flow_field(const flow_field &field, int grid_x, int grid_y, int &next_grid_x, int &next_grid_y) const
+    {
         static const std::array<std::pair<int, int>, 4> neighbor_offsets = {{{0, 1}, {1, 0}, {0, -1}, {-1, 0}}};
-        int target_index = get_index(target_x, target_y);
+
+        const int cell = get_cell(grid_x, grid_y);
+        const int distance = field.distance[cell];
+        if (distance < 0) {
+            return 0;
+        }
+
+        const int cell_x = cell % columns;
+        const int cell_y = cell / columns;
+        for (const auto& [dx, dy] : neighbor_offsets) {
+            const int neighbor_x = cell_x + dx;
+            const int neighbor_y = cell_y + dy;
+            if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= columns || neighbor_y >= rows) {
+                continue;
+            }
+
+            const int neighbor = neighbor_y * columns + neighbor_x;
+            if (field.distance[neighbor] == distance - 1 && (!blocked_cells[neighbor] || neighbor == field.target_index)) {
+                next_grid_x = neighbor_x;
+                next_grid_y = neighbor_y;
+                break;
+            }
+        }
+        return distance + 1;
+    }
+
+    // A* algorithm, writes the route from start to target (both included) into path as grid
+    // cell indices and leaves it empty if there is none. Blocked cells are never entered
+    // apart from the target itself. Does not allocate once path has grown to fit.
+    void find_path(int start_x, int start_y, int target_x, int target_y, std::vector<int> &path) {
+        static const std::array<std::pair<int, int>, 8> neighbor_offsets = {{
+            {0, 1}, {1, 0}, {0, -1}, {-1, 0},   // Straight
+            {1, 1}, {1, -1}, {-1, -1}, {-1, 1}  // Diagonal
+        }};
+        const bool diagonals = GameConfig::instance().path_finding_diagonals;
+        const std::size_t num_neighbors = diagonals ? 8 : 4;
+
+        path_search_context &context = search_context;
+        const int start_index = get_cell(start_x, start_y);
+        const int target_index = get_cell(target_x, target_y);
+        const int goal_x = target_index % columns;
+        const int goal_y = target_index / columns;
+        path.clear();
 
         // Initialize start node
-        Node* start_node = &all_nodes[get_index(start_x, start_y)];
-        start_node->grid_x = start_x;
-        start_node->grid_y = start_y;
-        start_node->g_cost = 0;
-        start_node->h_cost =  path_finding_system::manhattan_distance(start_x, start_y, target_x, target_y);
-        start_node->parent = nullptr;
-        open_set.push(start_node);
-        
+        context.begin_search();
+        context.touch(start_index);
+        context.g_cost[start_index] = 0;
+        context.f_cost[start_index] = heuristic(start_index % columns, start_index / columns, goal_x, goal_y, diagonals);
+        context.push_or_decrease(start_index);
 
         // A* loop
-        while (!open_set.empty()) {
-            Node* current = open_set.top();
-            open_set.pop();
-
-            if (current->visited) continue;
-            current->visited = true;
+        while (!context.heap.empty()) {
+            const int current = context.pop();
+            context.closed[current] = 1;
 
             // Check if reached the target and return reversed path back if we have
-            if (current->grid_x == target_x && current->grid_y == target_y) {
-                std::vector<Node> path;
-                while (current != nullptr) {
-                    path.push_back(*current);
-                    current = current->parent;
+            if (current == target_index) {
+                for (int cell = current; cell != -1; cell = context.parent[cell]) {
+                    path.push_back(cell);
                 }
                 std::reverse(path.begin(), path.end());
-                return path;
+                return;
             }
 
-            // Explore neighbors (does not do diagonals)
-            for (const auto& [dx, dy] : neighbor_offsets) {
-                int neighbor_x = current->grid_x + dx;
-                int neighbor_y = current->grid_y + dy;
-
-                int neighbor_index = get_index(neighbor_x, neighbor_y);
+            const int current_x = current % columns;
+            const int current_y = current / columns;
+            for (std::size_t i = 0; i < num_neighbors; ++i) {
+                const auto [dx, dy] = neighbor_offsets[i];
+                const int neighbor_x = current_x + dx;
+                const int neighbor_y = current_y + dy;
 
-                // Check if neighbor is within bounds or already in closed set
-                if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= GameConfig::instance().num_columns || neighbor_y >= GameConfig::instance().num_rows || all_nodes[neighbor_index].visited) {
+                // Check if neighbor is within bounds
+                if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= columns || neighbor_y >= rows) {
                     continue;
                 }
 
+                const int neighbor = neighbor_y * columns + neighbor_x;
+                if (blocked_cells[neighbor] && neighbor != target_index) {
+                    continue;
+                }
 
-                if (collidable_positions.count(neighbor_index) > 0) {
-                    if (target_index != neighbor_index) {
-                        all_nodes[neighbor_index].visited = true;
-                        continue;
-                    }
+                // No cutting corners past blocked cells when moving diagonally
+                const bool diagonal = dx != 0 && dy != 0;
+                if (diagonal && (blocked_cells[current_y * columns + neighbor_x] || blocked_cells[neighbor_y * columns + current_x])) {
+                    continue;
                 }
 
-                Node* neighbor = &all_nodes[neighbor_index];
-                int tentative_g_cost = current->g_cost + 1;
+                context.touch(neighbor);
+                if (context.closed[neighbor]) {
+                    continue;
+                }
 
-                if (neighbor->g_cost == 0 || tentative_g_cost < neighbor->g_cost) {
-                    neighbor->grid_x = neighbor_x;
-                    neighbor->grid_y = neighbor_y;
-                    neighbor->g_cost = tentative_g_cost;
-                    neighbor->h_cost =  path_finding_system::manhattan_distance(neighbor_x, neighbor_y, target_x, target_y);
-                    neighbor->parent = current;
-                    open_set.push(neighbor);
+                const int tentative_g_cost = context.g_cost[current] + (diagonal ? diagonal_cost : straight_cost);
+                if (tentative_g_cost < context.g_cost[neighbor]) {
+                    context.g_cost[neighbor] = tentative_g_cost;
+                    context.f_cost[neighbor] = tentative_g_cost + heuristic(neighbor_x, neighbor_y, goal_x, goal_y, diagonals);
+                    context.parent[neighbor] = current;
+                    context.push_or_decrease(neighbor);
                 }
             }
         }
 
-        // Return an empty path if no path is found
-        return {};
+        // Leave the path empty if no path is found
     }
 
-    void update(entt::registry& reg)
+    // Long routes go through the hierarchy when it is enabled, short ones are searched directly
+    void route(int start_x, int start_y, int target_x, int target_y, std::vector<int> &path)
     {
-        Uint32 now = SDL_GetTicks();
-        
-        std::unordered_set<int> collidable_positions;
-        auto view_collidable_entities = reg.view<sprite_component, collidable_component>();
-        view_collidable_entities.each([&](sprite_component &sprite, collidable_component &collidable) {
-            collidable_positions.insert(get_index(sprite.grid_x, sprite.grid_y));
-        });
+        if (GameConfig::instance().path_finding_mode == PathFindingMode::Hierarchical &&
+            hierarchy.find_path(get_cell(start_x, start_y), get_cell(target_x, target_y), path)) {
+            return;
+        }
+        find_path(start_x, start_y, target_x, target_y, path);
+    }
+
+    void update(entt::registry& reg, Uint32 now)
+    {
+        update_count += 1;
+        const bool use_flow_field = GameConfig::instance().path_finding_mode == PathFindingMode::FlowField;
+        if (walls_changed) {
+            refresh_walls(reg);
+        }
+        if (GameConfig::instance().path_finding_mode == PathFindingMode::Hierarchical && !hierarchy.built) {
+            hierarchy.build(wall_cells, columns, rows, GameConfig::instance().path_finding_cluster_size);
+        }
+        overlay_collidables(reg);
         bool updated_path_this_frame = false;
         auto view_path_finding = reg.view<sprite_component, transform_component, path_finding_component, targetting_component, combat_component>();
         view_path_finding.each([&](sprite_component &sprite, transform_component &transform, path_finding_component &path_finding, targetting_component &aquire_target, combat_component &combat) {           
@@ -122,34 +344,55 @@ struct path_finding_system
             if (reg.valid(target_entity) && reg.all_of<sprite_component>(target_entity)) {
                 // Retrieve the sprite component of the target entity
                 auto &target_sprite = reg.get<sprite_component>(target_entity);
+                int next_grid_x = sprite.grid_x;
+                int next_grid_y = sprite.grid_y;
 
-                // Grab path on initial frame for all entities
-                if (!path_finding.initialised) {
-                    path_finding.path = path_finding_system::find_path(reg, sprite.grid_x, sprite.grid_y, target_sprite.grid_x, target_sprite.grid_y, collidable_positions);
+                if (use_flow_field) {
+                    // Every enemy chasing this target shares one field, so there is nothing to throttle
+                    const flow_field &field = get_flow_field(target_entity, target_sprite);
+                    path_finding.path_length = read_flow_field(field, sprite.grid_x, sprite.grid_y, next_grid_x, next_grid_y);
                     path_finding.initialised = true;
-                }
+                } else {
+                    // Grab path on initial frame for all entities
+                    if (!path_finding.initialised) {
+                        route(sprite.grid_x, sprite.grid_y, target_sprite.grid_x, target_sprite.grid_y, path_finding.path);
+                        path_finding.initialised = true;
+                    }
+
+                    // Path finding is computationally expensive so 
+                    Uint32 elapsed_time = now - path_finding.last_path_find_time;
+                    if (elapsed_time >= (0.5 * 1000) && !updated_path_this_frame) {
+                        route(sprite.grid_x, sprite.grid_y, target_sprite.grid_x, target_sprite.grid_y, path_finding.path);
+                        path_finding.last_path_find_time = now;
+                        updated_path_this_frame = true;
+                    } 
 
-                // Path finding is computationally expensive so 
-                Uint32 elapsed_time = now - path_finding.last_path_find_time;
-                if (elapsed_time >= (0.5 * 1000) && !updated_path_this_frame) {
-                    path_finding.path = path_finding_system::find_path(reg, sprite.grid_x, sprite.grid_y, target_sprite.grid_x, target_sprite.grid_y, collidable_positions);
-                    path_finding.last_path_find_time = now;
-                    updated_path_this_frame = true;
-                } 
+                    path_finding.path_length = std::size(path_finding.path);
+                    if (path_finding.path_length >= 2) {
+                        next_grid_x = path_finding.path[1] % columns;
+                        next_grid_y = path_finding.path[1] / columns;
+                    }
+                }
 
                 // When we get close to player just track player
-                if (std::size(path_finding.path) < 3) {
+                if (path_finding.path_length < 3) {
                     aquire_target.target_x = aquire_target.player_x;
                     aquire_target.target_y = aquire_target.player_y;
                     // Attack when closing in on player
-                    if (std::size(path_finding.path) < 2) {
+                    if (path_finding.path_length < 2) {
                         combat.attacking = true;
                     }
                 } else {
-                    aquire_target.target_x = path_finding.path[1].grid_x * GameConfig::instance().grid_cell_width;
-                    aquire_target.target_y = path_finding.path[1].grid_y * GameConfig::instance().grid_cell_height;
+                    aquire_target.target_x = next_grid_x * GameConfig::instance().grid_cell_width;
+                    aquire_target.target_y = next_grid_y * GameConfig::instance().grid_cell_height;
                 }  
             }
         });
+
+        // Fields nobody chased this frame go, which includes every destroyed target, so the list
+        // stays as long as the number of live targets and a recycled entity never finds an old one
+        flow_fields.erase(std::remove_if(flow_fields.begin(), flow_fields.end(), [&](const flow_field &field) {
+            return field.built_on_update != update_count;
+        }), flow_fields.end());
     }
 };
\ No newline at end of file
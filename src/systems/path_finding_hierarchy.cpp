@@ -0,0 +1,459 @@
+#pragma once
+
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#include "path_search.cpp"
+
+// Hierarchical path finding (HPA*) over the static walls of the map.
+// The tile grid is cut into square clusters. Wherever two neighbouring clusters share
+// a run of open cells along their border an entrance is placed, giving one abstract
+// node on each side. Nodes in the same cluster are linked by their walking distance
+// inside that cluster. Long queries search this small graph and then only refine the
+// cluster sized segments along the way into cells.
+// Only walls are considered: moving actors are left to the collision system. Routes
+// are 4-way and use the same step cost as the flat A*.
+struct path_hierarchy
+{
+    static constexpr int step_cost = 10;
+
+    struct abstract_edge {
+        int to;
+        int cost;
+    };
+
+    struct abstract_node {
+        int cell;
+        int cluster;
+        int partner = -1;       // Node on the other side of the entrance
+        bool alive = false;
+        std::vector<abstract_edge> intra;
+    };
+
+    // Breadth first search confined to a single cluster, indexed by local cell
+    struct cluster_search {
+        std::vector<int> distance;  // steps from the source, -1 when unreachable
+        std::vector<int> parent;    // local index of the previous cell, -1 at the source
+        std::vector<int> queue;
+        int cluster = -1;
+    };
+
+    int columns = 0;
+    int rows = 0;
+    int cluster_size = 10;
+    int clusters_x = 0;
+    int clusters_y = 0;
+    bool built = false;
+
+    std::vector<std::uint8_t> wall_cells;
+    std::vector<std::uint8_t> dirty_clusters;
+    bool has_dirty_clusters = false;
+
+    std::vector<abstract_node> nodes;
+    std::vector<int> free_nodes;
+    std::vector<std::vector<int>> cluster_nodes;
+    std::vector<std::vector<int>> border_nodes; // Per cluster: [2c] right border, [2c + 1] bottom border
+
+    // Query scratch, reused between queries
+    cluster_search start_search, goal_search, segment_search;
+    path_search_context abstract_context;
+    std::vector<int> abstract_path;
+
+    void build(const std::vector<std::uint8_t> &walls, int num_columns, int num_rows, int num_cluster_size)
+    {
+        columns = num_columns;
+        rows = num_rows;
+        cluster_size = std::max(num_cluster_size, 2);
+        clusters_x = (columns + cluster_size - 1) / cluster_size;
+        clusters_y = (rows + cluster_size - 1) / cluster_size;
+        wall_cells = walls;
+
+        const int num_clusters = clusters_x * clusters_y;
+        dirty_clusters.assign(num_clusters, 0);
+        has_dirty_clusters = false;
+        nodes.clear();
+        free_nodes.clear();
+        cluster_nodes.assign(num_clusters, {});
+        border_nodes.assign(num_clusters * 2, {});
+
+        for (cluster_search *search : {&start_search, &goal_search, &segment_search}) {
+            search->distance.assign(cluster_size * cluster_size, -1);
+            search->parent.assign(cluster_size * cluster_size, -1);
+            search->queue.reserve(cluster_size * cluster_size);
+        }
+
+        for (int cluster = 0; cluster < num_clusters; ++cluster) {
+            build_border(cluster, true);
+            build_border(cluster, false);
+        }
+        for (int cluster = 0; cluster < num_clusters; ++cluster) {
+            build_intra_edges(cluster);
+        }
+        built = true;
+    }
+
+    int cluster_of(int cell) const
+    {
+        return ((cell / columns) / cluster_size) * clusters_x + (cell % columns) / cluster_size;
+    }
+
+    void cluster_bounds(int cluster, int &x0, int &y0, int &x1, int &y1) const
+    {
+        x0 = (cluster % clusters_x) * cluster_size;
+        y0 = (cluster / clusters_x) * cluster_size;
+        x1 = std::min(x0 + cluster_size, columns);
+        y1 = std::min(y0 + cluster_size, rows);
+    }
+
+    // A wall was added or removed, the cluster gets rebuilt before the next query
+    void set_wall(int grid_x, int grid_y, bool wall)
+    {
+        if (!built || grid_x < 0 || grid_y < 0 || grid_x >= columns || grid_y >= rows) {
+            return;
+        }
+        const int cell = grid_y * columns + grid_x;
+        if (wall_cells[cell] == wall) {
+            return;
+        }
+        wall_cells[cell] = wall;
+        dirty_clusters[cluster_of(cell)] = 1;
+        has_dirty_clusters = true;
+    }
+
+    // Rebuilds the entrances on the four borders of every dirty cluster and the
+    // intra-cluster edges of everything those entrances touch
+    void update_dirty_clusters()
+    {
+        if (!has_dirty_clusters) {
+            return;
+        }
+
+        const int num_clusters = clusters_x * clusters_y;
+        std::vector<std::uint8_t> intra_dirty(num_clusters, 0);
+        for (int cluster = 0; cluster < num_clusters; ++cluster) {
+            if (!dirty_clusters[cluster]) {
+                continue;
+            }
+            const int cx = cluster % clusters_x;
+            const int cy = cluster / clusters_x;
+
+            // Right and bottom borders belong to this cluster, left and top to its neighbours
+            rebuild_border(cluster, true);
+            rebuild_border(cluster, false);
+            if (cx > 0) rebuild_border(cluster - 1, true);
+            if (cy > 0) rebuild_border(cluster - clusters_x, false);
+
+            intra_dirty[cluster] = 1;
+            if (cx > 0) intra_dirty[cluster - 1] = 1;
+            if (cx + 1 < clusters_x) intra_dirty[cluster + 1] = 1;
+            if (cy > 0) intra_dirty[cluster - clusters_x] = 1;
+            if (cy + 1 < clusters_y) intra_dirty[cluster + clusters_x] = 1;
+            dirty_clusters[cluster] = 0;
+        }
+
+        for (int cluster = 0; cluster < num_clusters; ++cluster) {
+            if (intra_dirty[cluster]) {
+                build_intra_edges(cluster);
+            }
+        }
+        has_dirty_clusters = false;
+    }
+
+    // Routes from start to goal through the abstract graph and refines it into cells.
+    // Returns false when both ends are in the same or neighbouring clusters, where a
+    // flat search is just as cheap, and the caller should use that instead.
+    bool find_path(int start_cell, int goal_cell, std::vector<int> &path)
+    {
+        const int start_cluster = cluster_of(start_cell);
+        const int goal_cluster = cluster_of(goal_cell);
+        if (std::abs(start_cluster % clusters_x - goal_cluster % clusters_x) <= 1 &&
+            std::abs(start_cluster / clusters_x - goal_cluster / clusters_x) <= 1) {
+            return false;
+        }
+
+        update_dirty_clusters();
+        path.clear();
+
+        search_cluster(start_cluster, start_cell, start_search);
+        search_cluster(goal_cluster, goal_cell, goal_search);
+
+        // Two virtual nodes at the end of the node list stand in for start and goal
+        const int start_node = static_cast<int>(nodes.size());
+        const int goal_node = start_node + 1;
+        if (abstract_context.columns != goal_node + 1) {
+            abstract_context.resize(goal_node + 1, 1);
+        }
+
+        path_search_context &context = abstract_context;
+        const int goal_x = goal_cell % columns;
+        const int goal_y = goal_cell / columns;
+        auto node_heuristic = [&](int node) {
+            const int cell = node == start_node ? start_cell : nodes[node].cell;
+            return step_cost * (std::abs(cell % columns - goal_x) + std::abs(cell / columns - goal_y));
+        };
+        auto relax = [&](int from, int to, int cost) {
+            context.touch(to);
+            if (context.closed[to]) {
+                return;
+            }
+            const int tentative_g_cost = context.g_cost[from] + cost;
+            if (tentative_g_cost < context.g_cost[to]) {
+                context.g_cost[to] = tentative_g_cost;
+                context.f_cost[to] = tentative_g_cost + (to == goal_node ? 0 : node_heuristic(to));
+                context.parent[to] = from;
+                context.push_or_decrease(to);
+            }
+        };
+
+        context.begin_search();
+        context.touch(start_node);
+        context.g_cost[start_node] = 0;
+        context.f_cost[start_node] = node_heuristic(start_node);
+        context.push_or_decrease(start_node);
+
+        bool found = false;
+        while (!context.heap.empty()) {
+            const int current = context.pop();
+            context.closed[current] = 1;
+            if (current == goal_node) {
+                found = true;
+                break;
+            }
+
+            if (current == start_node) {
+                for (int node : cluster_nodes[start_cluster]) {
+                    const int steps = local_distance(start_search, nodes[node].cell);
+                    if (steps >= 0) relax(current, node, steps * step_cost);
+                }
+                continue;
+            }
+
+            const abstract_node &node = nodes[current];
+            if (node.partner >= 0) {
+                relax(current, node.partner, step_cost);
+            }
+            for (const abstract_edge &edge : node.intra) {
+                relax(current, edge.to, edge.cost);
+            }
+            if (node.cluster == goal_cluster) {
+                const int steps = local_distance(goal_search, node.cell);
+                if (steps >= 0) relax(current, goal_node, steps * step_cost);
+            }
+        }
+
+        if (!found) {
+            return true; // Unreachable, path stays empty
+        }
+
+        // Abstract route from start to goal, virtual nodes included
+        abstract_path.clear();
+        for (int node = goal_node; node != -1; node = context.parent[node]) {
+            abstract_path.push_back(node);
+        }
+        std::reverse(abstract_path.begin(), abstract_path.end());
+
+        // Refine one segment at a time, each one ends where the next begins
+        path.push_back(start_cell);
+        for (std::size_t i = 1; i < abstract_path.size(); ++i) {
+            const int from = abstract_path[i - 1];
+            const int to = abstract_path[i];
+
+            if (from == start_node) {
+                append_from_source(start_search, nodes[to].cell, path);
+            } else if (to == goal_node) {
+                append_to_source(goal_search, nodes[from].cell, path);
+            } else if (nodes[from].partner == to) {
+                path.push_back(nodes[to].cell);
+            } else {
+                search_cluster(nodes[from].cluster, nodes[from].cell, segment_search);
+                append_from_source(segment_search, nodes[to].cell, path);
+            }
+        }
+        return true;
+    }
+
+private:
+    int local_index(int cluster, int cell) const
+    {
+        int x0, y0, x1, y1;
+        cluster_bounds(cluster, x0, y0, x1, y1);
+        return (cell / columns - y0) * (x1 - x0) + (cell % columns - x0);
+    }
+
+    int local_distance(const cluster_search &search, int cell) const
+    {
+        return search.distance[local_index(search.cluster, cell)];
+    }
+
+    void search_cluster(int cluster, int source_cell, cluster_search &search)
+    {
+        int x0, y0, x1, y1;
+        cluster_bounds(cluster, x0, y0, x1, y1);
+        const int width = x1 - x0;
+        const int height = y1 - y0;
+
+        search.cluster = cluster;
+        std::fill(search.distance.begin(), search.distance.begin() + width * height, -1);
+        search.queue.clear();
+
+        const int source = local_index(cluster, source_cell);
+        search.distance[source] = 0;
+        search.parent[source] = -1;
+        search.queue.push_back(source);
+
+        for (std::size_t head = 0; head < search.queue.size(); ++head) {
+            const int local = search.queue[head];
+            const int local_x = local % width;
+            const int local_y = local / width;
+            const int neighbors[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+            for (const auto &offset : neighbors) {
+                const int next_x = local_x + offset[0];
+                const int next_y = local_y + offset[1];
+                if (next_x < 0 || next_y < 0 || next_x >= width || next_y >= height) {
+                    continue;
+                }
+                const int next = next_y * width + next_x;
+                if (search.distance[next] >= 0 || wall_cells[(y0 + next_y) * columns + (x0 + next_x)]) {
+                    continue;
+                }
+                search.distance[next] = search.distance[local] + 1;
+                search.parent[next] = local;
+                search.queue.push_back(next);
+            }
+        }
+    }
+
+    int global_cell(int cluster, int local) const
+    {
+        int x0, y0, x1, y1;
+        cluster_bounds(cluster, x0, y0, x1, y1);
+        return (y0 + local / (x1 - x0)) * columns + (x0 + local % (x1 - x0));
+    }
+
+    // Cells from the search source (exclusive) to cell (inclusive)
+    void append_from_source(const cluster_search &search, int cell, std::vector<int> &path)
+    {
+        const std::size_t first = path.size();
+        for (int local = local_index(search.cluster, cell); search.parent[local] != -1; local = search.parent[local]) {
+            path.push_back(global_cell(search.cluster, local));
+        }
+        std::reverse(path.begin() + first, path.end());
+    }
+
+    // Cells from cell (exclusive) to the search source (inclusive)
+    void append_to_source(const cluster_search &search, int cell, std::vector<int> &path)
+    {
+        for (int local = search.parent[local_index(search.cluster, cell)]; local != -1; local = search.parent[local]) {
+            path.push_back(global_cell(search.cluster, local));
+        }
+    }
+
+    int allocate_node(int cell, int cluster)
+    {
+        int id;
+        if (!free_nodes.empty()) {
+            id = free_nodes.back();
+            free_nodes.pop_back();
+        } else {
+            id = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+        }
+        abstract_node &node = nodes[id];
+        node.cell = cell;
+        node.cluster = cluster;
+        node.partner = -1;
+        node.alive = true;
+        node.intra.clear();
+        cluster_nodes[cluster].push_back(id);
+        return id;
+    }
+
+    void release_node(int id)
+    {
+        abstract_node &node = nodes[id];
+        auto &owner = cluster_nodes[node.cluster];
+        owner.erase(std::remove(owner.begin(), owner.end(), id), owner.end());
+        node.alive = false;
+        node.intra.clear();
+        free_nodes.push_back(id);
+    }
+
+    void rebuild_border(int cluster, bool right)
+    {
+        for (int id : border_nodes[cluster * 2 + (right ? 0 : 1)]) {
+            release_node(id);
+        }
+        build_border(cluster, right);
+    }
+
+    // Places entrances along the right or bottom border of a cluster. Short runs of open
+    // cells get one entrance in the middle, long ones one at each end.
+    void build_border(int cluster, bool right)
+    {
+        auto &border = border_nodes[cluster * 2 + (right ? 0 : 1)];
+        border.clear();
+
+        const int cx = cluster % clusters_x;
+        const int cy = cluster / clusters_x;
+        if ((right && cx + 1 >= clusters_x) || (!right && cy + 1 >= clusters_y)) {
+            return;
+        }
+        const int neighbour = right ? cluster + 1 : cluster + clusters_x;
+
+        int x0, y0, x1, y1;
+        cluster_bounds(cluster, x0, y0, x1, y1);
+        const int length = right ? y1 - y0 : x1 - x0;
+
+        // Cell on this side and the other side for position i along the border
+        auto inside = [&](int i) { return right ? (y0 + i) * columns + (x1 - 1) : (y1 - 1) * columns + (x0 + i); };
+        auto outside = [&](int i) { return right ? (y0 + i) * columns + x1 : y1 * columns + (x0 + i); };
+        auto open = [&](int i) { return !wall_cells[inside(i)] && !wall_cells[outside(i)]; };
+
+        auto add_entrance = [&](int i) {
+            const int a = allocate_node(inside(i), cluster);
+            const int b = allocate_node(outside(i), neighbour);
+            nodes[a].partner = b;
+            nodes[b].partner = a;
+            border.push_back(a);
+            border.push_back(b);
+        };
+
+        int run_start = -1;
+        for (int i = 0; i <= length; ++i) {
+            const bool is_open = i < length && open(i);
+            if (is_open && run_start < 0) {
+                run_start = i;
+            } else if (!is_open && run_start >= 0) {
+                const int run_end = i - 1;
+                if (run_end - run_start + 1 < 6) {
+                    add_entrance((run_start + run_end) / 2);
+                } else {
+                    add_entrance(run_start);
+                    add_entrance(run_end);
+                }
+                run_start = -1;
+            }
+        }
+    }
+
+    void build_intra_edges(int cluster)
+    {
+        const auto &members = cluster_nodes[cluster];
+        for (int id : members) {
+            abstract_node &node = nodes[id];
+            node.intra.clear();
+            search_cluster(cluster, node.cell, segment_search);
+            for (int other : members) {
+                if (other == id) {
+                    continue;
+                }
+                const int steps = local_distance(segment_search, nodes[other].cell);
+                if (steps >= 0) {
+                    node.intra.push_back({other, steps * step_cost});
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+// Reusable A* state sized to the map, allocated once and shared by every query.
+// Nothing is cleared between searches: a cell only counts as touched when its stamp
+// matches the current generation. The open set is an indexed binary heap of cell
+// indices so a cheaper route to a queued cell is a decrease-key rather than a re-push.
+struct path_search_context
+{
+    int columns = 0;
+    int rows = 0;
+    std::uint32_t generation = 0;
+
+    std::vector<std::uint32_t> stamp;   // generation that last touched the cell
+    std::vector<int> g_cost;
+    std::vector<int> f_cost;
+    std::vector<int> parent;            // -1 for the start cell
+    std::vector<std::uint8_t> closed;
+    std::vector<int> heap;              // open set, cell indices ordered by f_cost
+    std::vector<int> heap_position;     // slot in heap, -1 when not queued
+
+    void resize(int num_columns, int num_rows)
+    {
+        columns = num_columns;
+        rows = num_rows;
+        const std::size_t cells = columns * rows;
+        stamp.assign(cells, 0);
+        g_cost.resize(cells);
+        f_cost.resize(cells);
+        parent.resize(cells);
+        closed.resize(cells);
+        heap_position.resize(cells);
+        heap.clear();
+        heap.reserve(cells);
+        generation = 0;
+    }
+
+    void begin_search()
+    {
+        heap.clear();
+        generation += 1;
+        if (generation == 0) { // Wrapped around, old stamps could match again
+            std::fill(stamp.begin(), stamp.end(), 0);
+            generation = 1;
+        }
+    }
+
+    void touch(int cell)
+    {
+        if (stamp[cell] != generation) {
+            stamp[cell] = generation;
+            g_cost[cell] = std::numeric_limits<int>::max();
+            parent[cell] = -1;
+            closed[cell] = 0;
+            heap_position[cell] = -1;
+        }
+    }
+
+    // Lower f first, ties go to the cell nearer the target (higher g)
+    bool heap_less(int a, int b) const
+    {
+        return f_cost[a] < f_cost[b] || (f_cost[a] == f_cost[b] && g_cost[a] > g_cost[b]);
+    }
+
+    void heap_swap(int i, int j)
+    {
+        std::swap(heap[i], heap[j]);
+        heap_position[heap[i]] = i;
+        heap_position[heap[j]] = j;
+    }
+
+    void sift_up(int i)
+    {
+        while (i > 0) {
+            const int up = (i - 1) / 2;
+            if (!heap_less(heap[i], heap[up])) break;
+            heap_swap(i, up);
+            i = up;
+        }
+    }
+
+    void sift_down(int i)
+    {
+        const int size = static_cast<int>(heap.size());
+        while (true) {
+            const int left = 2 * i + 1;
+            const int right = left + 1;
+            int smallest = i;
+            if (left < size && heap_less(heap[left], heap[smallest])) smallest = left;
+            if (right < size && heap_less(heap[right], heap[smallest])) smallest = right;
+            if (smallest == i) break;
+            heap_swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    // Queue the cell or move it up if it is already queued with a worse cost
+    void push_or_decrease(int cell)
+    {
+        if (heap_position[cell] < 0) {
+            heap.push_back(cell);
+            heap_position[cell] = static_cast<int>(heap.size()) - 1;
+        }
+        sift_up(heap_position[cell]);
+    }
+
+    int pop()
+    {
+        const int top = heap.front();
+        heap_swap(0, static_cast<int>(heap.size()) - 1);
+        heap.pop_back();
+        heap_position[top] = -1;
+        if (!heap.empty()) {
+            sift_down(0);
+        }
+        return top;
+    }
+};
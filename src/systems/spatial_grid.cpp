@@ -0,0 +1,209 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <entt/entt.hpp>
+
+// Dense uniform grid of entities bucketed by grid cell.
+// Every entity lives in one contiguous array sorted by cell with a counting sort,
+// cell_offsets[i] to cell_offsets[i + 1] being the slice for cell i. The storage is
+// kept between rebuilds so once it has grown to fit the crowd, building allocates nothing.
+// Cells outside the grid hold nothing: entities there are left out, like they were never
+// near anything on the map, and a rectangle only goes into the cells of it inside the grid.
+struct spatial_grid
+{
+    int columns = 0;
+    int rows = 0;
+
+    std::vector<std::uint32_t> cell_offsets; // columns * rows + 1 entries
+    std::vector<entt::entity> cell_entities; // entities ordered by cell
+
+    // Scratch space used while building
+    std::vector<entt::entity> pending_entities;
+    std::vector<std::uint32_t> pending_cells;
+    std::vector<std::uint32_t> cell_cursor;
+
+    void resize(int num_columns, int num_rows)
+    {
+        columns = std::max(num_columns, 1);
+        rows = std::max(num_rows, 1);
+        cell_offsets.assign(columns * rows + 1, 0);
+        cell_cursor.assign(columns * rows, 0);
+    }
+
+    int clamp_column(int grid_x) const { return std::clamp(grid_x, 0, columns - 1); }
+    int clamp_row(int grid_y) const { return std::clamp(grid_y, 0, rows - 1); }
+
+    bool contains(int grid_x, int grid_y) const
+    {
+        return grid_x >= 0 && grid_y >= 0 && grid_x < columns && grid_y < rows;
+    }
+
+    // Trims a range of cells to the part inside the grid, false when none of it is
+    bool clip(int& first_x, int& first_y, int& last_x, int& last_y) const
+    {
+        first_x = std::max(first_x, 0);
+        first_y = std::max(first_y, 0);
+        last_x = std::min(last_x, columns - 1);
+        last_y = std::min(last_y, rows - 1);
+        return first_x <= last_x && first_y <= last_y;
+    }
+
+    void begin_build()
+    {
+        pending_entities.clear();
+        pending_cells.clear();
+    }
+
+    void add(entt::entity entity, int grid_x, int grid_y)
+    {
+        if (!contains(grid_x, grid_y)) {
+            return;
+        }
+        pending_entities.push_back(entity);
+        pending_cells.push_back(grid_y * columns + grid_x);
+    }
+
+    // Adds entity to every cell from (first_x, first_y) to (last_x, last_y) inclusive, for
+    // things that span several cells. Queries over more than one cell can then see it twice.
+    void add(entt::entity entity, int first_x, int first_y, int last_x, int last_y)
+    {
+        if (!clip(first_x, first_y, last_x, last_y)) {
+            return;
+        }
+        for (int grid_y = first_y; grid_y <= last_y; ++grid_y) {
+            for (int grid_x = first_x; grid_x <= last_x; ++grid_x) {
+                pending_entities.push_back(entity);
+                pending_cells.push_back(grid_y * columns + grid_x);
+            }
+        }
+    }
+
+    // Counting sort of everything added since begin_build(), keeps insertion order within a cell
+    void end_build()
+    {
+        std::fill(cell_offsets.begin(), cell_offsets.end(), 0);
+        for (std::uint32_t cell : pending_cells) {
+            cell_offsets[cell + 1] += 1;
+        }
+        for (std::size_t i = 1; i < cell_offsets.size(); ++i) {
+            cell_offsets[i] += cell_offsets[i - 1];
+        }
+
+        std::copy(cell_offsets.begin(), cell_offsets.end() - 1, cell_cursor.begin());
+        cell_entities.resize(pending_entities.size());
+        for (std::size_t i = 0; i < pending_entities.size(); ++i) {
+            cell_entities[cell_cursor[pending_cells[i]]++] = pending_entities[i];
+        }
+    }
+
+    // grid_x/grid_y must already be inside the grid (see clip and clamp_column/clamp_row)
+    template <typename ProcessEntityFunc>
+    void for_each_in_cell(int grid_x, int grid_y, ProcessEntityFunc&& process_entity) const
+    {
+        const std::uint32_t cell = grid_y * columns + grid_x;
+        for (std::uint32_t i = cell_offsets[cell]; i < cell_offsets[cell + 1]; ++i) {
+            process_entity(cell_entities[i]);
+        }
+    }
+};
+
+// Grid of entities bucketed by grid cell that entities go into and come out of one at a
+// time, for things that seldom change like sleeping movers. Each cell is a list chained
+// through one node pool, so nothing is rebuilt and an empty cell costs one index.
+// Cells outside the grid hold nothing, like spatial_grid.
+struct incremental_grid
+{
+    static constexpr std::uint32_t no_node = ~0u;
+
+    struct node {
+        entt::entity entity;
+        std::uint32_t next;
+    };
+
+    int columns = 0;
+    int rows = 0;
+
+    std::vector<std::uint32_t> cell_first; // columns * rows entries, no_node when empty
+    std::vector<node> nodes;
+    std::uint32_t first_free = no_node;    // Free nodes are chained through next
+
+    void resize(int num_columns, int num_rows)
+    {
+        columns = std::max(num_columns, 1);
+        rows = std::max(num_rows, 1);
+        clear();
+    }
+
+    void clear()
+    {
+        cell_first.assign(columns * rows, no_node);
+        nodes.clear();
+        first_free = no_node;
+    }
+
+    // Trims a range of cells to the part inside the grid, false when none of it is
+    bool clip(int& first_x, int& first_y, int& last_x, int& last_y) const
+    {
+        first_x = std::max(first_x, 0);
+        first_y = std::max(first_y, 0);
+        last_x = std::min(last_x, columns - 1);
+        last_y = std::min(last_y, rows - 1);
+        return first_x <= last_x && first_y <= last_y;
+    }
+
+    // Adds entity to every cell from (first_x, first_y) to (last_x, last_y) inclusive
+    void add(entt::entity entity, int first_x, int first_y, int last_x, int last_y)
+    {
+        if (!clip(first_x, first_y, last_x, last_y)) {
+            return;
+        }
+        for (int grid_y = first_y; grid_y <= last_y; ++grid_y) {
+            for (int grid_x = first_x; grid_x <= last_x; ++grid_x) {
+                std::uint32_t& first = cell_first[grid_y * columns + grid_x];
+                std::uint32_t index = first_free;
+                if (index == no_node) {
+                    index = static_cast<std::uint32_t>(nodes.size());
+                    nodes.push_back(node{});
+                } else {
+                    first_free = nodes[index].next;
+                }
+                nodes[index] = node{entity, first};
+                first = index;
+            }
+        }
+    }
+
+    // Takes entity out of the same cells it was added to
+    void remove(entt::entity entity, int first_x, int first_y, int last_x, int last_y)
+    {
+        if (!clip(first_x, first_y, last_x, last_y)) {
+            return;
+        }
+        for (int grid_y = first_y; grid_y <= last_y; ++grid_y) {
+            for (int grid_x = first_x; grid_x <= last_x; ++grid_x) {
+                std::uint32_t* link = &cell_first[grid_y * columns + grid_x];
+                while (*link != no_node && nodes[*link].entity != entity) {
+                    link = &nodes[*link].next;
+                }
+                if (*link != no_node) {
+                    const std::uint32_t index = *link;
+                    *link = nodes[index].next;
+                    nodes[index].next = first_free;
+                    first_free = index;
+                }
+            }
+        }
+    }
+
+    // grid_x/grid_y must already be inside the grid
+    template <typename ProcessEntityFunc>
+    void for_each_in_cell(int grid_x, int grid_y, ProcessEntityFunc&& process_entity) const
+    {
+        for (std::uint32_t index = cell_first[grid_y * columns + grid_x]; index != no_node; index = nodes[index].next) {
+            process_entity(nodes[index].entity);
+        }
+    }
+};
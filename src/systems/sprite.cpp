@@ -5,11 +5,30 @@
 #include "../components/render_layer.h"
 #include "../config/game_config.h"
 #include "../components/weapon.h"
+#include "sprite_batch.cpp"
+#include "background_layer.cpp"
+#include "spatial_grid.cpp"
+#include "camera.cpp"
 
 #include <entt/entt.hpp>
 
 struct sprite_system 
 {
+    sprite_batch batch; // Each render pass goes out in one draw call per texture
+    background_layer background; // Terrain baked into chunk textures
+    spatial_grid visibility_grid; // Moving sprites by grid cell, rebuilt every update
+    std::vector<entt::entity> visible; // Moving sprites inside the camera view, filled by cull()
+
+    // Sprites reach at most this many cells past their own cell (scenery is drawn 2x2)
+    static constexpr int cull_margin_cells = 2;
+
+    // World size in grid cells
+    void resize(int map_columns, int map_rows)
+    {
+        visibility_grid.resize(std::max(map_columns, GameConfig::instance().num_columns), std::max(map_rows, GameConfig::instance().num_rows));
+        background.resize(map_columns, map_rows);
+    }
+
     static std::pair<int, int> get_grid_position(int x, int y)
     {
         int grid_x = x / GameConfig::instance().grid_cell_width;
@@ -26,53 +45,79 @@ struct sprite_system
 
             auto weapon_owner_transform = reg.try_get<transform_component>(weapon.owner_entt);
 
+            const bool moved = sprite.dst.x != weapon_owner_transform->pos_x || sprite.dst.y != weapon_owner_transform->pos_y;
             sprite.dst.x = weapon_owner_transform->pos_x;
             sprite.dst.y = weapon_owner_transform->pos_y;
 
             auto [grid_x, grid_y] = get_grid_position(sprite.dst.x, sprite.dst.y);
             sprite.grid_x = grid_x;
             sprite.grid_y = grid_y;           
+            if (moved) {
+                reg.patch<sprite_component>(entity); // Wakes it in collision_system if it sleeps
+            }
         });
     }
 
     void update(entt::registry& reg)
     {
-        // Updates position (will not pull back terrain as terrain has no transform component)
-        auto view_transform = reg.view<sprite_component, transform_component>();
-        view_transform.each([&](entt::entity entity, sprite_component &sprite, transform_component &transform){
+        // Updates position. The group owns both pools, so this walks two packed arrays in step.
+        auto group_transform = reg.group<sprite_component, transform_component>();
+        visibility_grid.begin_build();
+        group_transform.each([&](entt::entity entity, sprite_component &sprite, transform_component &transform){
+                if (sprite.dst.x != transform.pos_x || sprite.dst.y != transform.pos_y) {
+                    reg.patch<sprite_component>(entity); // Wakes it in collision_system if it sleeps
+                }
                 sprite.dst.x = transform.pos_x;
                 sprite.dst.y = transform.pos_y;
 
                 auto [grid_x, grid_y] = get_grid_position(sprite.dst.x, sprite.dst.y);
                 sprite.grid_x = grid_x;
                 sprite.grid_y = grid_y;           
+                visibility_grid.add(entity, grid_x, grid_y);
         });
+        visibility_grid.end_build();
     }
 
-    void render_background(entt::registry& reg, SDL_Renderer* renderer)
+    // Finds the moving sprites overlapping view through the visibility grid
+    void cull(entt::registry& reg, const SDL_Rect& view)
     {
-        // Create a view for sprite components
-        auto view_sprite = reg.view<sprite_component, background_component>();
-
-        view_sprite.each([&](sprite_component &sprite) {
-
-            SDL_RenderCopy(
-                renderer, 
-                sprite.texture, 
-                &sprite.src, 
-                &sprite.dst
-            );
-        });
+        visible.clear();
+        auto [first_x, first_y] = get_grid_position(view.x, view.y);
+        auto [last_x, last_y] = get_grid_position(view.x + view.w - 1, view.y + view.h - 1);
+        first_x = visibility_grid.clamp_column(first_x - cull_margin_cells);
+        first_y = visibility_grid.clamp_row(first_y - cull_margin_cells);
+        last_x = visibility_grid.clamp_column(last_x);
+        last_y = visibility_grid.clamp_row(last_y);
+
+        for (int cell_y = first_y; cell_y <= last_y; ++cell_y) {
+            for (int cell_x = first_x; cell_x <= last_x; ++cell_x) {
+                visibility_grid.for_each_in_cell(cell_x, cell_y, [&](entt::entity entity) {
+                    auto sprite = reg.valid(entity) ? reg.try_get<sprite_component>(entity) : nullptr;
+                    if (sprite && camera_system::overlaps(sprite->dst, view)) {
+                        visible.push_back(entity);
+                    }
+                });
+            }
+        }
     }
 
-    void render_layer_one(entt::registry& reg, SDL_Renderer* renderer)
+    void render_background(entt::registry& reg, SDL_Renderer* renderer, const SDL_Rect& view)
     {
-        // Create a view for sprite components
-        auto view_sprite = reg.view<sprite_component, transform_component, layer_one_component>();
+        background.render(reg, renderer, batch, view);
+    }
 
-        view_sprite.each([&](sprite_component &sprite, transform_component &transform) {
+    // Layer passes only draw what the last cull() found
+    void render_layer_one(entt::registry& reg, SDL_Renderer* renderer, const SDL_Rect& view)
+    {
+        for (entt::entity entity : visible) {
+            if (!reg.all_of<transform_component, layer_one_component>(entity)) {
+                continue;
+            }
+            const auto &sprite = reg.get<sprite_component>(entity);
+            const auto &transform = reg.get<transform_component>(entity);
+            const auto &sprite_texture = reg.get<sprite_texture_component>(entity);
             if (!sprite.visible) {
-                return;
+                continue;
             }
             double angle = 0;
             if (transform.direction == Direction::R) {
@@ -93,22 +138,26 @@ struct sprite_system
                 angle = 315.0;
             } 
 
-            SDL_RenderCopyEx(renderer, sprite.texture, &sprite.src, &sprite.dst, angle, nullptr, SDL_FLIP_NONE);
-        });
+            batch.add(sprite_texture.texture, sprite_texture.src, to_screen(sprite.dst, view), angle);
+        }
+        batch.flush(renderer);
     }
 
-    void render_layer_two(entt::registry& reg, SDL_Renderer* renderer)
+    void render_layer_two(entt::registry& reg, SDL_Renderer* renderer, const SDL_Rect& view)
     {
-        // Create a view for sprite components
-        auto view_sprite = reg.view<sprite_component, layer_two_component>();
-
-        view_sprite.each([&](sprite_component &sprite) {
-            SDL_RenderCopy(
-                renderer, 
-                sprite.texture, 
-                &sprite.src, 
-                &sprite.dst
-            );
-        });
+        for (entt::entity entity : visible) {
+            if (!reg.all_of<layer_two_component>(entity)) {
+                continue;
+            }
+            const auto &sprite = reg.get<sprite_component>(entity);
+            const auto &sprite_texture = reg.get<sprite_texture_component>(entity);
+            batch.add(sprite_texture.texture, sprite_texture.src, to_screen(sprite.dst, view));
+        }
+        batch.flush(renderer);
+    }
+
+    static SDL_Rect to_screen(const SDL_Rect& world, const SDL_Rect& view)
+    {
+        return SDL_Rect{world.x - view.x, world.y - view.y, world.w, world.h};
     }
 };
\ No newline at end of file
@@ -3,20 +3,29 @@
 #include "../components/transform.h"
 #include "../components/sprite.h"
 #include "../components/sprite_animation.h"
+#include "camera.cpp"
 
 #include <entt/entt.hpp>
 
 struct sprite_animation_system 
 {   
-    void update(entt::registry& reg)
+    // Sprites outside view (the camera) are not on screen so their animation is left paused
+    void update(entt::registry& reg, const SDL_Rect& view)
     {
-        auto view = reg.view<sprite_character_animation_component, transform_component, sprite_component, hitpoints_component>();
+        // Partly owning group, see declare_groups
+        auto group_animation = reg.group<sprite_character_animation_component, sprite_texture_component, hitpoints_component>(
+            entt::get<sprite_component, transform_component>);
 
-        view.each([](sprite_character_animation_component& animation, 
-                    transform_component& transform, 
+        group_animation.each([&](sprite_character_animation_component& animation, 
+                    sprite_texture_component& sprite_texture, 
+                    hitpoints_component& hp,
                     sprite_component& sprite, 
-                    hitpoints_component& hp)
+                    transform_component& transform)
         {
+            if (!camera_system::overlaps(sprite.dst, view)) {
+                return;
+            }
+
             // --- Direction Handling ---
             auto direction_to_index = [](Direction dir) -> int {
                 switch (dir) {
@@ -34,7 +43,7 @@ struct sprite_animation_system
             animation.sprite_direction = direction_to_index(transform.direction);
 
             // --- Movement Status ---
-            bool is_running = (transform.vel_x != 0 || transform.vel_y != 0);
+            bool is_running = (transform.move_x != 0 || transform.move_y != 0);
             bool is_stunned = hp.stunned;
 
             // --- Frame Count Update ---
@@ -71,17 +80,20 @@ struct sprite_animation_system
             }
 
             // --- Sprite Source Rect Update ---
-            sprite.src.x = (animation.sprite_selection_count * sprite.src_w) + animation.padding;
-            sprite.src.y = (animation.sprite_direction * sprite.src_h) + animation.padding + 10;
-            sprite.src.w = sprite.src_w - (2 * animation.padding);
-            sprite.src.h = sprite.src_h - (2 * animation.padding);
+            sprite_texture.src.x = sprite_texture.src_origin.x + (animation.sprite_selection_count * sprite_texture.src_w) + animation.padding;
+            sprite_texture.src.y = sprite_texture.src_origin.y + (animation.sprite_direction * sprite_texture.src_h) + animation.padding + 10;
+            sprite_texture.src.w = sprite_texture.src_w - (2 * animation.padding);
+            sprite_texture.src.h = sprite_texture.src_h - (2 * animation.padding);
         });
     }
 
-    void update_scenery_animation(entt::registry& reg)
+    void update_scenery_animation(entt::registry& reg, const SDL_Rect& view)
     {
-        auto view_transform = reg.view<sprite_scenery_animation_component, sprite_component>();
-        view_transform.each([](sprite_scenery_animation_component &sprite_animation, sprite_component &sprite){
+        auto view_transform = reg.view<sprite_scenery_animation_component, sprite_component, sprite_texture_component>();
+        view_transform.each([&](sprite_scenery_animation_component &sprite_animation, sprite_component &sprite, sprite_texture_component &sprite_texture){
+            if (!camera_system::overlaps(sprite.dst, view)) {
+                return;
+            }
 
             if (sprite_animation.sprite_frame_count < 10) {
                 sprite_animation.sprite_frame_count += 1;
@@ -94,7 +106,7 @@ struct sprite_animation_system
                 }
             }
             
-            sprite.src.x = ((sprite.src_w + sprite_animation.sprite_pixel_modifier) * sprite_animation.sprite_selection_count);
+            sprite_texture.src.x = sprite_texture.src_origin.x + ((sprite_texture.src_w + sprite_animation.sprite_pixel_modifier) * sprite_animation.sprite_selection_count);
             // std::cout << "SRC XY: (" << sprite.src.x << ", " << sprite.src.y << ") Select Count: " << sprite_animation.sprite_selection_count << " SRC WIDTH: " << sprite.src.w << '\n';
         });
     }
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+// Collects textured quads for one render pass and submits them with as few draw calls
+// as possible. Quads are drawn in the order they were added, so overlapping sprites
+// keep their z-order, and every run of consecutive quads sharing a texture (atlas page)
+// goes out as a single SDL_RenderGeometry call. The vectors are kept between frames so
+// a steady scene allocates nothing.
+struct sprite_batch
+{
+    struct quad {
+        SDL_Texture* texture;
+        SDL_Rect src;
+        SDL_Rect dst;
+        double angle; // Degrees clockwise around the centre of dst, like SDL_RenderCopyEx
+    };
+
+    std::vector<quad> quads;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    int draw_calls = 0; // Calls made by the last flush
+
+    void add(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, double angle = 0.0)
+    {
+        if (texture) {
+            quads.push_back({texture, src, dst, angle});
+        }
+    }
+
+    void flush(SDL_Renderer* renderer)
+    {
+        draw_calls = 0;
+        for (std::size_t begin = 0; begin < quads.size();) {
+            SDL_Texture* texture = quads[begin].texture;
+            std::size_t end = begin;
+            while (end < quads.size() && quads[end].texture == texture) {
+                ++end;
+            }
+
+            int texture_w = 0, texture_h = 0;
+            SDL_QueryTexture(texture, nullptr, nullptr, &texture_w, &texture_h);
+            if (texture_w > 0 && texture_h > 0) {
+                vertices.clear();
+                indices.clear();
+                for (std::size_t i = begin; i < end; ++i) {
+                    append(quads[i], 1.0f / texture_w, 1.0f / texture_h);
+                }
+                SDL_RenderGeometry(renderer, texture, vertices.data(), static_cast<int>(vertices.size()), indices.data(), static_cast<int>(indices.size()));
+                draw_calls += 1;
+            }
+            begin = end;
+        }
+        quads.clear();
+    }
+
+private:
+    void append(const quad& q, float texel_u, float texel_v)
+    {
+        const float u0 = q.src.x * texel_u, u1 = (q.src.x + q.src.w) * texel_u;
+        const float v0 = q.src.y * texel_v, v1 = (q.src.y + q.src.h) * texel_v;
+        const float half_w = q.dst.w * 0.5f, half_h = q.dst.h * 0.5f;
+        const float centre_x = q.dst.x + half_w, centre_y = q.dst.y + half_h;
+
+        // Corners relative to the centre, rotated clockwise (y points down)
+        const float radians = static_cast<float>(q.angle * 3.14159265358979323846 / 180.0);
+        const float c = std::cos(radians), s = std::sin(radians);
+        const float corners[4][4] = {
+            {-half_w, -half_h, u0, v0},
+            { half_w, -half_h, u1, v0},
+            { half_w,  half_h, u1, v1},
+            {-half_w,  half_h, u0, v1},
+        };
+
+        const int first = static_cast<int>(vertices.size());
+        for (const auto& corner : corners) {
+            SDL_Vertex vertex;
+            vertex.position.x = centre_x + corner[0] * c - corner[1] * s;
+            vertex.position.y = centre_y + corner[0] * s + corner[1] * c;
+            vertex.color = SDL_Color{255, 255, 255, 255};
+            vertex.tex_coord.x = corner[2];
+            vertex.tex_coord.y = corner[3];
+            vertices.push_back(vertex);
+        }
+        for (int index : {0, 1, 2, 0, 2, 3}) {
+            indices.push_back(first + index);
+        }
+    }
+};
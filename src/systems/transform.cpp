@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "../components/transform.h"
 #include <entt/entt.hpp>
 
@@ -19,12 +21,49 @@ struct transform_system
     }
 
 
-    void update(entt::registry& reg)
+    // Whole pixels to move this frame: the velocity plus the fraction carried over, rounded down.
+    // Collision checks these (and may cut them short) before update() applies them.
+    void update_velocities(entt::registry& reg)
     {
         auto view_transform = reg.view<transform_component>();
         view_transform.each([](transform_component &transform){
-            transform.pos_x += transform.vel_x;
-            transform.pos_y += transform.vel_y;         
+            transform.vel_x = whole_pixels(transform.sub_x + transform.move_x);
+            transform.vel_y = whole_pixels(transform.sub_y + transform.move_y);
         });
     }
+
+    // Moves by the whole pixels left in vel and carries the rest of the velocity over as a
+    // fraction of a pixel. An axis that was cut short (blocked or stunned) drops its fraction,
+    // so it stays where it was stopped. Branch free, so loops over it vectorise.
+    static void integrate(transform_component& transform)
+    {
+        const fixed total_x = transform.sub_x + transform.move_x;
+        const fixed total_y = transform.sub_y + transform.move_y;
+        const fixed keep_x = -static_cast<fixed>(transform.vel_x == whole_pixels(total_x)); // All bits set or none
+        const fixed keep_y = -static_cast<fixed>(transform.vel_y == whole_pixels(total_y));
+        transform.sub_x = pixel_fraction(total_x) & keep_x;
+        transform.sub_y = pixel_fraction(total_y) & keep_y;
+        transform.pos_x += transform.vel_x;
+        transform.pos_y += transform.vel_y;
+    }
+
+    // The same over packed transforms
+    static void integrate(transform_component* transforms, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            integrate(transforms[i]);
+        }
+    }
+
+    // Every transform moves, so the kernel runs straight over the storage's pages of packed
+    // components rather than through a view one entity at a time
+    void update(entt::registry& reg)
+    {
+        auto& storage = reg.storage<transform_component>();
+        auto pages = storage.raw();
+        constexpr std::size_t page_size = entt::component_traits<transform_component>::page_size;
+        for (std::size_t first = 0; first < storage.size(); first += page_size) {
+            integrate(pages[first / page_size], std::min(page_size, storage.size() - first));
+        }
+    }
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+// Converts map.txt style maps into the chunked binary map the game loads whole (see
+// world/map_format.hpp). Each text file becomes one layer, in the order given, and every
+// layer takes the size of the largest.
+//
+//   g++ -std=c++17 -O2 -o map_converter tools/map_converter.cpp
+//   ./map_converter assets/maps/map.bin assets/maps/map.txt [more layers...] [--chunk-size 32]
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "../world/map_format.hpp"
+
+int main(int argc, char* argv[])
+{
+    std::uint32_t chunk_size = map_file_default_chunk_size;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc) {
+            chunk_size = static_cast<std::uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() < 2) {
+        std::cerr << "Usage: map_converter <output.bin> <layer.txt> [more layers...] [--chunk-size N]\n";
+        return 1;
+    }
+
+    // Every layer as rows of tile ids
+    std::vector<std::vector<std::vector<std::uint16_t>>> layers;
+    std::uint32_t columns = 0, rows = 0;
+    for (std::size_t i = 1; i < paths.size(); ++i) {
+        std::ifstream text(paths[i]);
+        if (!text.is_open()) {
+            std::cerr << "Error: Could not open map file " << paths[i] << '\n';
+            return 1;
+        }
+        std::vector<std::vector<std::uint16_t>> layer;
+        std::string line;
+        while (std::getline(text, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            std::vector<std::uint16_t> row;
+            for (char tile : line) {
+                row.push_back(tile_from_char(tile));
+            }
+            columns = std::max<std::uint32_t>(columns, static_cast<std::uint32_t>(row.size()));
+            layer.push_back(std::move(row));
+        }
+        rows = std::max<std::uint32_t>(rows, static_cast<std::uint32_t>(layer.size()));
+        layers.push_back(std::move(layer));
+    }
+    if (columns == 0 || rows == 0) {
+        std::cerr << "Error: The map is empty\n";
+        return 1;
+    }
+
+    map_file_header header{};
+    std::memcpy(header.magic, "DQMP", 4);
+    header.version = map_file_version;
+    header.columns = columns;
+    header.rows = rows;
+    header.chunk_size = chunk_size;
+    header.layers = static_cast<std::uint32_t>(layers.size());
+    header.chunks_x = (columns + chunk_size - 1) / chunk_size;
+    header.chunks_y = (rows + chunk_size - 1) / chunk_size;
+
+    std::ofstream out(paths[0], std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write " << paths[0] << '\n';
+        return 1;
+    }
+    unsigned char header_bytes[map_file_header_size];
+    encode_map_header(header, header_bytes);
+    out.write(reinterpret_cast<const char*>(header_bytes), sizeof(header_bytes));
+
+    // Tiles are written little endian whatever the host, like the header
+    std::vector<unsigned char> chunk(static_cast<std::size_t>(chunk_size) * chunk_size * 2);
+    for (std::uint32_t chunk_y = 0; chunk_y < header.chunks_y; ++chunk_y) {
+        for (std::uint32_t chunk_x = 0; chunk_x < header.chunks_x; ++chunk_x) {
+            for (const auto& layer : layers) {
+                std::fill(chunk.begin(), chunk.end(), 0);
+                for (std::uint32_t y = 0; y < chunk_size; ++y) {
+                    const std::uint32_t row = chunk_y * chunk_size + y;
+                    for (std::uint32_t x = 0; x < chunk_size && row < layer.size(); ++x) {
+                        const std::uint32_t column = chunk_x * chunk_size + x;
+                        if (column < layer[row].size()) {
+                            const std::size_t offset = (static_cast<std::size_t>(y) * chunk_size + x) * 2;
+                            chunk[offset] = layer[row][column] & 0xff;
+                            chunk[offset + 1] = layer[row][column] >> 8;
+                        }
+                    }
+                }
+                out.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+            }
+        }
+    }
+
+    std::cout << paths[0] << ": " << columns << "x" << rows << " tiles, " << layers.size() << " layer(s), "
+              << header.chunks_x << "x" << header.chunks_y << " chunks of " << chunk_size << '\n';
+    return out ? 0 : 1;
+}
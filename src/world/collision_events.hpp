@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include <entt/entt.hpp>
+
+// One contact between an entity that detects collisions (a) and a collidable it touched (b)
+struct collision_event {
+    enum phase_type : std::uint8_t {
+        enter = 1 << 0, // Touching this frame but not the last
+        stay = 1 << 1,  // Touching both frames
+        exit = 1 << 2,  // Touched last frame but not this one, b may have been destroyed since
+    };
+    static constexpr std::uint8_t touching = enter | stay;
+
+    entt::entity a;
+    entt::entity b;
+    std::uint32_t kinds; // Bit per subscribed component type b had when the contact began
+    phase_type phase;
+};
+
+// The frame's contacts as enter/stay/exit events, worked out by diffing the sorted contact
+// pairs of this frame against the last. Consumers subscribe to the component types they
+// care about on b and each<Component>() then filters on a bit worked out once when the
+// contact began, so nothing looks b up again while it stays in contact. The event buffer
+// is reused every frame, after the first few frames it stops allocating.
+struct collision_events
+{
+    // Lets each<Component>() pick out contacts with entities that have Component. Call before the first frame.
+    template <typename Component>
+    void subscribe(entt::registry& reg)
+    {
+        if (kind_bit<Component>() >= 0) {
+            return;
+        }
+        assert(m_kinds.size() < 32);
+        auto& storage = reg.storage<Component>();
+        m_kinds.push_back({entt::type_hash<Component>::value(), [&storage](entt::entity entity) { return storage.contains(entity); }});
+    }
+
+    // Replaces the contacts with this frame's (a, b) pairs and works out the events. Sorts touching.
+    void publish(std::vector<std::pair<entt::entity, entt::entity>>& touching)
+    {
+        std::sort(touching.begin(), touching.end());
+        touching.erase(std::unique(touching.begin(), touching.end()), touching.end());
+
+        m_events.clear();
+        m_next_contacts.clear();
+        std::size_t old_index = 0;
+        for (const auto& [a, b] : touching) {
+            while (old_index < m_contacts.size() && before(m_contacts[old_index], a, b)) {
+                const contact& ended = m_contacts[old_index++];
+                m_events.push_back({ended.a, ended.b, ended.kinds, collision_event::exit});
+            }
+            if (old_index < m_contacts.size() && m_contacts[old_index].a == a && m_contacts[old_index].b == b) {
+                const contact& kept = m_contacts[old_index++];
+                m_events.push_back({a, b, kept.kinds, collision_event::stay});
+                m_next_contacts.push_back(kept);
+            } else {
+                const std::uint32_t kinds = kinds_of(b);
+                m_events.push_back({a, b, kinds, collision_event::enter});
+                m_next_contacts.push_back({a, b, kinds});
+            }
+        }
+        for (; old_index < m_contacts.size(); ++old_index) {
+            const contact& ended = m_contacts[old_index];
+            m_events.push_back({ended.a, ended.b, ended.kinds, collision_event::exit});
+        }
+        m_contacts.swap(m_next_contacts);
+    }
+
+    // Calls func(event) for every event in phases (a mask of collision_event::phase_type) with b having Component
+    template <typename Component, typename Func>
+    void each(std::uint8_t phases, Func&& func) const
+    {
+        const int bit = kind_bit<Component>();
+        assert(bit >= 0 && "subscribe<Component>() first");
+        for (const collision_event& event : m_events) {
+            if ((event.phase & phases) && (event.kinds >> bit & 1u)) {
+                func(event);
+            }
+        }
+    }
+
+    // Calls func(event) for every event in phases
+    template <typename Func>
+    void each(std::uint8_t phases, Func&& func) const
+    {
+        for (const collision_event& event : m_events) {
+            if (event.phase & phases) {
+                func(event);
+            }
+        }
+    }
+
+    const std::vector<collision_event>& events() const { return m_events; }
+
+    void clear()
+    {
+        m_events.clear();
+        m_contacts.clear();
+    }
+
+private:
+    struct contact {
+        entt::entity a;
+        entt::entity b;
+        std::uint32_t kinds;
+    };
+
+    struct kind {
+        entt::id_type type;
+        std::function<bool(entt::entity)> has;
+    };
+
+    std::vector<kind> m_kinds;
+    std::vector<collision_event> m_events;
+    std::vector<contact> m_contacts;      // Last frame's, sorted by (a, b)
+    std::vector<contact> m_next_contacts;
+
+    static bool before(const contact& c, entt::entity a, entt::entity b)
+    {
+        return std::make_pair(c.a, c.b) < std::make_pair(a, b);
+    }
+
+    template <typename Component>
+    int kind_bit() const
+    {
+        for (std::size_t i = 0; i < m_kinds.size(); ++i) {
+            if (m_kinds[i].type == entt::type_hash<Component>::value()) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    std::uint32_t kinds_of(entt::entity entity) const
+    {
+        std::uint32_t kinds = 0;
+        for (std::size_t i = 0; i < m_kinds.size(); ++i) {
+            if (m_kinds[i].has(entity)) {
+                kinds |= 1u << i;
+            }
+        }
+        return kinds;
+    }
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+#include <entt/entt.hpp>
+
+// Structural changes (create, emplace, remove, destroy) recorded while systems iterate and
+// applied together at a sync point with flush(), so nothing changes a pool that another
+// system may be walking. Safe to record into from several threads at once. Commands are
+// kept in blocks of memory that are reused after each flush, so recording stops allocating
+// once the first few frames have been through. flush() runs creates and component changes
+// in the order they were recorded, then destroys everything queued in one batch.
+struct command_buffer
+{
+    // An entity create() has queued. emplace() can target it, and a pending passed as a
+    // component argument becomes the entity, before it exists.
+    struct pending {
+        std::size_t index;
+    };
+
+    pending create()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return {m_creates++};
+    }
+
+    template <typename Component, typename... Args>
+    void emplace(entt::entity entity, Args&&... args)
+    {
+        record_emplace<Component>(target{entity, 0}, std::forward<Args>(args)...);
+    }
+
+    template <typename Component, typename... Args>
+    void emplace(pending entity, Args&&... args)
+    {
+        record_emplace<Component>(target{entt::null, entity.index}, std::forward<Args>(args)...);
+    }
+
+    // Calls func with the entity's Component, emplacing a default one first if it has none.
+    // For changes that add to a component other commands in the same flush may emplace.
+    template <typename Component, typename Func>
+    void get_or_emplace(entt::entity entity, Func&& func)
+    {
+        record([entity, func = std::forward<Func>(func)](entt::registry& reg, const std::vector<entt::entity>&) mutable {
+            if (reg.valid(entity)) {
+                func(reg.get_or_emplace<Component>(entity));
+            }
+        });
+    }
+
+    template <typename Component>
+    void remove(entt::entity entity)
+    {
+        record([entity](entt::registry& reg, const std::vector<entt::entity>&) {
+            if (reg.valid(entity)) {
+                reg.remove<Component>(entity);
+            }
+        });
+    }
+
+    // Destroying the same entity twice, or one that has gone by the flush, is fine
+    void destroy(entt::entity entity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_destroys.push_back(entity);
+    }
+
+    bool empty() const
+    {
+        return m_creates == 0 && m_commands.empty() && m_destroys.empty();
+    }
+
+    // Only at a sync point, when no system is recording or reading the registry. Commands
+    // that signal handlers record while it runs (on_construct and the like) are applied too.
+    void flush(entt::registry& reg)
+    {
+        m_created.clear();
+        for (std::size_t i = 0;; ++i) {
+            while (m_created.size() < m_creates) {
+                m_created.push_back(reg.create());
+            }
+            if (i == m_commands.size()) {
+                break;
+            }
+            m_commands[i]->apply(m_commands[i], reg, m_created);
+        }
+        m_creates = 0;
+
+        for (command* cmd : m_commands) {
+            cmd->drop(cmd);
+        }
+        m_commands.clear();
+        m_arena.reset();
+
+        std::sort(m_destroys.begin(), m_destroys.end());
+        m_destroys.erase(std::unique(m_destroys.begin(), m_destroys.end()), m_destroys.end());
+        m_destroys.erase(std::remove_if(m_destroys.begin(), m_destroys.end(), [&reg](entt::entity entity) { return !reg.valid(entity); }), m_destroys.end());
+        reg.destroy(m_destroys.begin(), m_destroys.end());
+        m_destroys.clear();
+    }
+
+    // The entities made by the last flush's creates, indexed by pending::index
+    const std::vector<entt::entity>& created() const { return m_created; }
+
+private:
+    // An existing entity, or a pending one when entity is null
+    struct target {
+        entt::entity entity;
+        std::size_t pending;
+
+        entt::entity resolve(const std::vector<entt::entity>& created) const
+        {
+            return entity == entt::null ? created[pending] : entity;
+        }
+    };
+
+    // Component arguments go through unchanged, apart from pending entities
+    template <typename Value>
+    static Value&& resolve_argument(Value&& value, const std::vector<entt::entity>&)
+    {
+        return std::forward<Value>(value);
+    }
+
+    static entt::entity resolve_argument(pending entity, const std::vector<entt::entity>& created)
+    {
+        return created[entity.index];
+    }
+
+    struct command {
+        void (*apply)(command*, entt::registry&, const std::vector<entt::entity>&);
+        void (*drop)(command*);
+    };
+
+    template <typename Func>
+    struct command_of : command {
+        Func func;
+
+        explicit command_of(Func&& f)
+            : command{&command_of::apply_func, &command_of::drop_func}, func(std::move(f)) { }
+
+        static void apply_func(command* cmd, entt::registry& reg, const std::vector<entt::entity>& created)
+        {
+            static_cast<command_of*>(cmd)->func(reg, created);
+        }
+
+        static void drop_func(command* cmd)
+        {
+            static_cast<command_of*>(cmd)->~command_of();
+        }
+    };
+
+    // Fixed size blocks handed out front to back, kept when reset so they are reused
+    struct arena {
+        static constexpr std::size_t block_size = 64 * 1024;
+
+        std::vector<std::unique_ptr<std::byte[]>> blocks;
+        std::size_t block = 0;
+        std::size_t offset = 0;
+
+        void* allocate(std::size_t size, std::size_t align)
+        {
+            offset = (offset + align - 1) / align * align;
+            if (blocks.empty() || offset + size > block_size) {
+                if (!blocks.empty()) {
+                    ++block;
+                }
+                offset = 0;
+                if (block == blocks.size()) {
+                    blocks.push_back(std::make_unique<std::byte[]>(block_size));
+                }
+            }
+            void* memory = blocks[block].get() + offset;
+            offset += size;
+            return memory;
+        }
+
+        void reset()
+        {
+            block = 0;
+            offset = 0;
+        }
+    };
+
+    template <typename Component, typename... Args>
+    void record_emplace(target entity, Args&&... args)
+    {
+        record([entity, values = std::make_tuple(std::forward<Args>(args)...)](entt::registry& reg, const std::vector<entt::entity>& created) mutable {
+            const entt::entity resolved = entity.resolve(created);
+            if (!reg.valid(resolved)) {
+                return;
+            }
+            std::apply([&](auto&&... value) { reg.emplace_or_replace<Component>(resolved, resolve_argument(std::move(value), created)...); }, std::move(values));
+        });
+    }
+
+    template <typename Func>
+    void record(Func&& func)
+    {
+        using stored = command_of<std::decay_t<Func>>;
+        static_assert(sizeof(stored) <= arena::block_size, "command too large for the arena");
+        static_assert(alignof(stored) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "command over-aligned for the arena");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        void* memory = m_arena.allocate(sizeof(stored), alignof(stored));
+        m_commands.push_back(new (memory) stored(std::forward<Func>(func)));
+    }
+
+    std::mutex m_mutex;
+    arena m_arena;
+    std::vector<command*> m_commands;
+    std::size_t m_creates = 0;
+    std::vector<entt::entity> m_created;
+    std::vector<entt::entity> m_destroys;
+};
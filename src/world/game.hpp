@@ -5,6 +5,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "../systems/camera.cpp"
 #include "../systems/collision.cpp"
 #include "../systems/collidable.cpp"
 #include "../systems/combat.cpp"
@@ -20,7 +21,14 @@
 #include "../systems/item_retrieval.cpp"
 #include "../systems/targetting.cpp"
 #include "../systems/transform.cpp"
+#include "../components/label.h"
 #include "load_map.cpp"
+#include "simulation_clock.hpp"
+#include "replay.hpp"
+#include "texture_cache.hpp"
+#include "scheduler.hpp"
+#include "command_buffer.hpp"
+#include "groups.hpp"
 
 namespace cwt {
 
@@ -28,125 +36,298 @@ namespace cwt {
 class game
 {
     public: 
-        game()
+        // A headless game never opens a window or renderer and runs on a fixed step clock
+        explicit game(bool headless = false)
+            : m_headless(headless), m_window(nullptr), m_renderer(nullptr)
         {
-            m_window = SDL_CreateWindow(
-                "sdl window",
-                SDL_WINDOWPOS_UNDEFINED,
-                SDL_WINDOWPOS_UNDEFINED,
-                GameConfig::instance().screen_width,
-                GameConfig::instance().screen_height,
-                SDL_WINDOW_SHOWN
-            );
+            m_is_running = true;
+            m_clock.fixed_step = headless;
 
-            if (m_window == NULL) {
-                std::cout << "Could not create window: " << SDL_GetError() << '\n';
-                m_is_running = false;
-            }
-            m_renderer = SDL_CreateRenderer(m_window, -1, 0);
-            if (!m_renderer) {
-                std::cout << "Error creating SDL renderer.\n";
-                m_is_running = false;
+            if (!m_headless) {
+                create_window();
             }
 
-            m_is_running = true;
+            // Sprites and the tilemap hand their texture references back to the cache when they are destroyed
+            m_texture_cache.renderer = m_renderer;
+            m_registry.on_destroy<sprite_texture_component>().connect<&texture_cache::on_sprite_destroyed>(m_texture_cache);
+            m_registry.on_destroy<tilemap_component>().connect<&texture_cache::on_tilemap_destroyed>(m_texture_cache);
+
+            // Map tiles, scenery, weapons and items share atlas pages so they draw in a few batches.
+            // The character sheets are wider than a page and stay textures of their own.
+            m_texture_cache.build_atlas({
+                "assets/images/wall.jpg",
+                "assets/images/brick.jpg",
+                "assets/images/sword.png",
+                "assets/images/explosion-rays.png",
+                "assets/images/player.png",
+                "assets/images/zombie.png",
+                "assets/images/undead_tileset/PNG/Animation1.png",
+                "assets/images/undead_tileset/PNG/Animation4.png",
+                "assets/images/undead_tileset/PNG/Animation5.png",
+                "assets/images/undead_tileset/PNG/Animation6.png",
+            });
+
+            m_sprite_system.background.connect(m_registry);
+            m_path_finding_system.connect(m_registry);
+            m_map_dimensions = load_map_file("assets/maps/map.bin", m_registry, m_texture_cache);
+            m_collision_system.resize(m_map_dimensions.columns, m_map_dimensions.rows);
+            m_collision_system.connect(m_registry);
+            m_collision_system.events.subscribe<damage_component>(m_registry);
+            m_collision_system.events.subscribe<item_component>(m_registry);
+            m_path_finding_system.resize(m_map_dimensions.columns, m_map_dimensions.rows);
+            m_sprite_system.resize(m_map_dimensions.columns, m_map_dimensions.rows);
+            m_camera_system.resize(m_map_dimensions.columns, m_map_dimensions.rows);
+            m_health_system.connect(m_registry, m_commands);
 
-            load_map("assets/maps/map.txt", m_registry, m_renderer);
-            m_collision_system.load_static_entities(m_registry);
+            // Systems read the registry from several threads, so no pool may be created lazily
+            prewarm_storage<
+                camera_component, collidable_component, collision_detection_component, combat_component,
+                cooldown_component, damage_component, hitpoints_component, inventory_component, item_component, label_component, layer_one_component,
+                layer_two_component, life_bar_component, owned_component, path_finding_component, player_component, sprite_character_animation_component,
+                sprite_component, sprite_scenery_animation_component, sprite_texture_component, targetting_component, tilemap_component, transform_component,
+                weapon_component
+            >(m_registry);
+            declare_groups(m_registry);
+            schedule_systems();
         }
         ~game()
         {       
-            SDL_DestroyWindow(m_window);
+            m_scheduler.stop();
+            m_sprite_system.background.clear();
+            m_texture_cache.clear();
+            if (m_renderer) {
+                SDL_DestroyRenderer(m_renderer);
+            }
+            if (m_window) {
+                SDL_DestroyWindow(m_window);
+            }
             SDL_Quit();
         }
 
         entt::registry& get_registry() { return m_registry; }
+        command_buffer& get_commands() { return m_commands; }
         SDL_Renderer* get_renderer() { return m_renderer; }
+        texture_cache& get_texture_cache() { return m_texture_cache; }
+        performance_logging_system& get_profiler() { return m_performance_logging_system; }
+        simulation_clock& get_clock() { return m_clock; }
+        input_replay& get_input_replay() { return m_input_replay; }
 
         bool is_running()
         {
             return m_is_running;
         }
 
+        bool is_headless()
+        {
+            return m_headless;
+        }
+
         void read_input()
         {
-            SDL_Event sdl_event;
-            SDL_PollEvent(&sdl_event);            
-            const Uint8* keystates = SDL_GetKeyboardState(NULL);
+            input_state input;
+
+            if (m_input_replay.replaying()) {
+                if (!m_input_replay.read(input)) {
+                    m_is_running = false; // Recording has run out
+                }
+            } else if (!m_headless) {
+                SDL_Event sdl_event;
+                SDL_PollEvent(&sdl_event);            
+                const Uint8* keystates = SDL_GetKeyboardState(NULL);
+
+                input.left = keystates[SDL_SCANCODE_A];
+                input.right = keystates[SDL_SCANCODE_D];
+                input.up = keystates[SDL_SCANCODE_W];
+                input.down = keystates[SDL_SCANCODE_S];
+                input.attack = keystates[SDL_SCANCODE_L];
+                input.quit = keystates[SDL_SCANCODE_ESCAPE] || sdl_event.type == SDL_QUIT;
+
+                // Profile summary on demand, not part of the recorded input
+                if (sdl_event.type == SDL_KEYDOWN && sdl_event.key.keysym.scancode == SDL_SCANCODE_P && m_performance_logging_system.enabled) {
+                    m_performance_logging_system.report(std::cout);
+                }
+                if (sdl_event.type == SDL_RENDER_TARGETS_RESET || sdl_event.type == SDL_RENDER_DEVICE_RESET) {
+                    m_sprite_system.background.invalidate_all();
+                }
+            }
+
+            if (m_input_replay.recording()) {
+                m_input_replay.record(input);
+            }
 
-            if (keystates[SDL_SCANCODE_ESCAPE] || sdl_event.type == SDL_QUIT) {
+            if (input.quit) {
                 m_is_running = false;
             }
+            m_input = input;
         }
 
+        // Systems run on the scheduler, see schedule_systems() for the order and what each touches
         void update()
         {  
-            // m_performance_logging_system.start();
-            
+            // Sync point for anything recorded between frames, such as spawning
+            m_commands.flush(m_registry);
+
+            m_frame_now = m_clock.now();
+            m_frame_view = m_camera_system.get_view(m_registry);
+
+            m_performance_logging_system.begin_frame();
+            m_scheduler.run();
+
+            // Sync point for anything recorded after the last flush in the frame
+            m_commands.flush(m_registry);
+
+            m_clock.advance();
+        }
+
+        void render()
+        {
+            if (!m_renderer) {
+                m_performance_logging_system.end_frame();
+                return;
+            }
+
+            m_performance_logging_system.measure("texture_cache::upload_decoded", [&] { m_texture_cache.upload_decoded(); });
+
+            SDL_RenderClear(m_renderer);
+
+            // Everything below draws what the camera sees, the cooldown bar is fixed to the screen
+            const SDL_Rect view = m_camera_system.get_view(m_registry);
+            m_performance_logging_system.measure("sprite_system::cull", [&] { m_sprite_system.cull(m_registry, view); });
+
+            m_performance_logging_system.measure("sprite_system::render_background", [&] { m_sprite_system.render_background(m_registry, m_renderer, view); });
+            m_performance_logging_system.measure("sprite_system::render_layer_one", [&] { m_sprite_system.render_layer_one(m_registry, m_renderer, view); });
+            m_performance_logging_system.measure("sprite_system::render_layer_two", [&] { m_sprite_system.render_layer_two(m_registry, m_renderer, view); });
+            m_performance_logging_system.measure("damage_system::render_life_bars", [&] { m_damage_system.render_life_bars(m_registry, m_renderer, m_sprite_system.visible, view); });
+            m_performance_logging_system.measure("damage_system::render_cooldowns", [&] { m_damage_system.render_cooldowns(m_registry, m_renderer); });
+            // m_visual_logging_system.render(m_registry, m_renderer, m_path_finding_system.columns);
+            m_performance_logging_system.measure("SDL_RenderPresent", [&] { SDL_RenderPresent(m_renderer); });
+
+            m_performance_logging_system.end_frame();
+        }
+
+    private:
+        // Systems in the order they ran single threaded, with the components they read and write
+        void schedule_systems()
+        {
+            using S = system_scheduler;
+
             // Find out where everything is heading this frame
-            m_movement_system.update_players(m_registry);
-            m_targetting_system.update(m_registry);
-            m_path_finding_system.update(m_registry);
-            m_movement_system.update_enemies(m_registry);
-            m_movement_system.update_directions(m_registry);
-            m_sprite_animation_system.update(m_registry);
-            m_sprite_animation_system.update_scenery_animation(m_registry);
+            m_scheduler.add("movement_system::update_players", S::resources<player_component>(), S::resources<transform_component, combat_component>(),
+                [this] { m_movement_system.update_players(m_registry, m_input); });
+            m_scheduler.add("targetting_system::update", S::resources<transform_component, player_component>(), S::resources<targetting_component>(),
+                [this] { m_targetting_system.update(m_registry); });
+            m_scheduler.add("path_finding_system::update", S::resources<sprite_component, collidable_component, transform_component, tilemap_component>(),
+                S::resources<path_finding_component, targetting_component, combat_component>(),
+                [this] { m_path_finding_system.update(m_registry, m_frame_now); });
+            m_scheduler.add("movement_system::update_enemies", S::resources<targetting_component>(), S::resources<transform_component>(),
+                [this] { m_movement_system.update_enemies(m_registry); });
+            m_scheduler.add("transform_system::update_velocities", S::resources<>(), S::resources<transform_component>(),
+                [this] { m_transform_system.update_velocities(m_registry); });
+            m_scheduler.add("movement_system::update_directions", S::resources<>(), S::resources<transform_component>(),
+                [this] { m_movement_system.update_directions(m_registry); });
+            m_scheduler.add("sprite_animation_system::update", S::resources<transform_component, sprite_component, hitpoints_component>(),
+                S::resources<sprite_character_animation_component, sprite_texture_component, console_resource>(),
+                [this] { m_sprite_animation_system.update(m_registry, m_frame_view); });
+            m_scheduler.add("sprite_animation_system::update_scenery_animation", S::resources<sprite_component>(), S::resources<sprite_scenery_animation_component, sprite_texture_component>(),
+                [this] { m_sprite_animation_system.update_scenery_animation(m_registry, m_frame_view); });
 
             // Set weapon coords to be same as the weapon owner
-            m_transform_system.update_weapons(m_registry);
-            m_sprite_system.update_weapons(m_registry);
+            m_scheduler.add("transform_system::update_weapons", S::resources<weapon_component>(), S::resources<transform_component>(),
+                [this] { m_transform_system.update_weapons(m_registry); });
+            m_scheduler.add("sprite_system::update_weapons", S::resources<weapon_component, transform_component>(), S::resources<sprite_component>(),
+                [this] { m_sprite_system.update_weapons(m_registry); });
 
             // Work out where the weapons are depending on various things
-            m_combat_system.update_weapon_states(m_registry);
-            
+            m_scheduler.add("combat_system::update_weapon_states", S::resources<weapon_component>(),
+                S::resources<sprite_component, transform_component, damage_component, combat_component>(),
+                [this] { m_combat_system.update_weapon_states(m_registry, m_frame_now); });
+
             // Work out collisions and damage
-            m_collision_system.update(m_registry);  
-            m_combat_system.update(m_registry);         
-            m_damage_system.update(m_registry);
-            
+            m_scheduler.add("collision_system::update", S::resources<sprite_component, collidable_component, weapon_component, tilemap_component, collision_detection_component>(),
+                S::resources<transform_component, collision_events>(),
+                [this] { m_collision_system.update(m_registry); });
+            m_scheduler.add("combat_system::update", S::resources<collision_events, collision_detection_component>(), S::resources<hitpoints_component, damage_component>(),
+                [this] { m_combat_system.update(m_registry, m_collision_system.events); });
+            m_scheduler.add("damage_system::update", S::resources<>(), S::resources<hitpoints_component, life_bar_component>(),
+                [this] { m_damage_system.update(m_registry); });
+
             // Handles application of various statuses
-            m_combat_system.update_character_statuses(m_registry);
+            m_scheduler.add("combat_system::update_character_statuses", S::resources<>(), S::resources<hitpoints_component, transform_component>(),
+                [this] { m_combat_system.update_character_statuses(m_registry); });
 
             // Handles collection of things
-            m_item_retrieval_system.update(m_registry);
-            
-            // Handles removal of dead characters
-            m_health_system.update(m_registry);
-            m_health_system.update_item_clear_up(m_registry);
-            
+            m_scheduler.add("item_retrieval_system::update", S::resources<collision_events, player_component>(),
+                S::resources<item_component, inventory_component, console_resource>(),
+                [this] { m_item_retrieval_system.update(m_registry, m_collision_system.events); });
+
+            // Handles removal of dead characters and collected items, applied at the sync point after them
+            m_scheduler.add("health_system::update", S::resources<hitpoints_component, owned_component>(), S::resources<command_buffer>(),
+                [this] { m_health_system.update(m_registry, m_commands); });
+            m_scheduler.add("health_system::update_item_clear_up", S::resources<item_component>(), S::resources<command_buffer>(),
+                [this] { m_health_system.update_item_clear_up(m_registry, m_commands); });
+            m_scheduler.add_exclusive("command_buffer::flush", [this] { m_commands.flush(m_registry); });
+
             // Finalise positions and animation frames of everything
-            m_transform_system.update(m_registry);  
-            
-            m_sprite_system.update(m_registry);
-            
-            m_logging_system.update(m_registry, 3);          
+            m_scheduler.add("transform_system::update", S::resources<>(), S::resources<transform_component>(),
+                [this] { m_transform_system.update(m_registry); });
+            m_scheduler.add("sprite_system::update", S::resources<transform_component>(), S::resources<sprite_component>(),
+                [this] { m_sprite_system.update(m_registry); });
+            m_scheduler.add_exclusive("camera_system::update", [this] { m_camera_system.update(m_registry); });
+
+            m_scheduler.add("logging_system::update",
+                S::resources<sprite_component, transform_component, collision_detection_component, hitpoints_component, player_component,
+                    path_finding_component, targetting_component, collision_events>(),
+                S::resources<console_resource>(),
+                [this] { m_logging_system.update(m_registry, m_collision_system.events, m_frame_now, 3); });
+
+            m_collision_system.scheduler = &m_scheduler;
+            m_scheduler.profiler = &m_performance_logging_system;
+            m_scheduler.start(GameConfig::instance().worker_threads);
         }
 
-        void render()
+        void create_window()
         {
-            SDL_RenderClear(m_renderer);
-
-            m_sprite_system.render_background(m_registry, m_renderer);
-            m_sprite_system.render_layer_one(m_registry, m_renderer);
-            m_sprite_system.render_layer_two(m_registry, m_renderer);
-            m_damage_system.render_life_bars(m_registry, m_renderer);
-            m_damage_system.render_cooldowns(m_registry, m_renderer);
-            // m_visual_logging_system.render(m_registry, m_renderer);
-            SDL_RenderPresent(m_renderer);
+            m_window = SDL_CreateWindow(
+                "sdl window",
+                SDL_WINDOWPOS_UNDEFINED,
+                SDL_WINDOWPOS_UNDEFINED,
+                GameConfig::instance().screen_width,
+                GameConfig::instance().screen_height,
+                SDL_WINDOW_SHOWN
+            );
 
-            // m_performance_logging_system.stop();
+            if (m_window == NULL) {
+                std::cout << "Could not create window: " << SDL_GetError() << '\n';
+                m_is_running = false;
+                return;
+            }
+            m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+            if (!m_renderer) {
+                std::cout << "Error creating SDL renderer.\n";
+                m_is_running = false;
+            }
         }
 
-    private:
         std::size_t m_width;
         std::size_t m_height;
+        bool m_headless;
         SDL_Window* m_window; 
         SDL_Renderer* m_renderer;
         bool m_is_running;
 
+        map_dimensions m_map_dimensions;
+        texture_cache m_texture_cache;
+        simulation_clock m_clock;
+        input_replay m_input_replay;
+        input_state m_input;
+        Uint32 m_frame_now = 0;     // Clock reading for the systems running this frame
+        SDL_Rect m_frame_view{};    // Camera view at the start of this frame
+
         entt::registry m_registry;
+        command_buffer m_commands; // Creates, component changes and destroys recorded by systems and spawning
 
         sprite_system m_sprite_system;
+        camera_system m_camera_system;
         sprite_animation_system m_sprite_animation_system;
         transform_system m_transform_system;
         path_finding_system m_path_finding_system;
@@ -160,6 +341,7 @@ class game
         logging_system m_logging_system;
         visual_logging_system m_visual_logging_system;
         performance_logging_system m_performance_logging_system;
+        system_scheduler m_scheduler;
 };
 
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/sprite.h"
+#include "../components/collision.h"
+#include "../components/sprite_animation.h"
+#include "../components/health.h"
+
+// Owning groups for the queries every frame runs over the whole crowd. A group keeps the
+// components it owns packed in the same order at the front of their pools, so iterating it
+// walks arrays in step instead of probing the other pools entity by entity.
+//
+//   sprite + transform                        sprite_system::update, collision narrow phase
+//   sprite + transform + collision_detection  collision_system::update, nested in the above
+//   character animation + sprite texture + hitpoints, with sprite and transform looked up
+//                                             sprite_animation_system::update
+//
+// A type can only be owned by one family of nested groups, which is why the animation group
+// only partly owns its components. Systems must ask for a group with exactly these types.
+// Call this before entities are made (and before other threads read the registry), as
+// making a group sorts the pools it owns.
+inline void declare_groups(entt::registry& reg)
+{
+    reg.group<sprite_component, transform_component>();
+    reg.group<sprite_component, transform_component, collision_detection_component>();
+    reg.group<sprite_character_animation_component, sprite_texture_component, hitpoints_component>(entt::get<sprite_component, transform_component>);
+}
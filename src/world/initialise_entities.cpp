@@ -3,8 +3,10 @@
 #include <utility>
 
 #include "game.hpp"
+#include "command_buffer.hpp"
 #include "../components/transform.h"
 #include "../components/sprite.h"
+#include "../components/label.h"
 #include "../components/collision.h"
 #include "../components/collidable.h"
 #include "../components/path_finding.h"
@@ -28,15 +30,16 @@ std::pair<int, int> get_source_dimensions(
     int num_sprites_y
 ) 
 {
-    SDL_Texture* texture = IMG_LoadTexture(game.get_renderer(), texture_path);
-    if (!texture) {
-        SDL_Log("Failed to load texture: %s", SDL_GetError());
-        // Handle error (e.g., return {0, 0}, throw exception, etc.)
+    // Nothing to measure without a renderer (headless)
+    if (!game.get_renderer()) {
         return {0, 0};
     }
 
     int texture_width = 0, texture_height = 0;
-    SDL_QueryTexture(texture, nullptr, nullptr, &texture_width, &texture_height);
+    if (!game.get_texture_cache().dimensions(texture_path, texture_width, texture_height)) {
+        // Handle error (e.g., return {0, 0}, throw exception, etc.)
+        return {0, 0};
+    }
 
     // std::cout << "TOTAL WIDTH/HEIGHT: " << texture_width << ", " << texture_height << '\n';
 
@@ -45,8 +48,19 @@ std::pair<int, int> get_source_dimensions(
     return {src_w, src_h}; // return as a pair
 }
 
-entt::entity create_player_animated(cwt::game &game, const char *texture_path, int x, int y) {
-    auto player_entity = game.get_registry().create();
+// Shifts the source rect onto where the image sits inside its texture (see texture_cache::origin)
+void place_in_texture(cwt::game &game, sprite_texture_component &sprite_texture, const char *texture_path)
+{
+    sprite_texture.src_origin = game.get_texture_cache().origin(texture_path);
+    sprite_texture.src.x += sprite_texture.src_origin.x;
+    sprite_texture.src.y += sprite_texture.src_origin.y;
+}
+
+// The create_* helpers record the new entity into the game's command buffer, so they can
+// be called between frames or from a system. The entity exists from the next flush on.
+command_buffer::pending create_player_animated(cwt::game &game, const char *texture_path, int x, int y) {
+    command_buffer &commands = game.get_commands();
+    auto player_entity = commands.create();
     int player_width = GameConfig::instance().grid_cell_width;
     int player_height = GameConfig::instance().grid_cell_height;
     int cooldown_height = 8;
@@ -62,37 +76,39 @@ entt::entity create_player_animated(cwt::game &game, const char *texture_path, i
     int padding = 30;
     auto [src_w, src_h] = get_source_dimensions(game, texture_path, num_sprites_x, num_sprites_y);
 
-    game.get_registry().emplace<player_component>(player_entity);
-    game.get_registry().emplace<sprite_component>(player_entity, 
+    sprite_texture_component sprite_texture{
         128, 128,
-        SDL_Rect{0, 0, src_w, src_h}, 
-        SDL_Rect{x, y, player_width, player_height},
-        IMG_LoadTexture(game.get_renderer(), texture_path),
-        0, 0,
-        true,
-        std::string("PLAYER")
-    );
-    game.get_registry().emplace<sprite_character_animation_component>(player_entity, 1, 0, 0, first_sprite_index, last_sprite_index, padding);
-    game.get_registry().emplace<transform_component>(player_entity, x, y, 0, 0, 4);
-    game.get_registry().emplace<collision_detection_component>(player_entity, 'F');
-    game.get_registry().emplace<collidable_component>(player_entity, true);
-    game.get_registry().emplace<hitpoints_component>(player_entity, 10, 10);
-    game.get_registry().emplace<life_bar_component>(player_entity, player_width, 8, SDL_Color{0, 255, 0, 255}, SDL_Rect{x, y, player_width, 8});
-    game.get_registry().emplace<combat_component>(player_entity, false, false, 10, 0, 0, 3000, SDL_GetTicks());
-    game.get_registry().emplace<cooldown_component>(
+        SDL_Rect{0, 0, src_w, src_h},
+        game.get_texture_cache().acquire(texture_path)
+    };
+    place_in_texture(game, sprite_texture, texture_path);
+
+    commands.emplace<player_component>(player_entity);
+    commands.emplace<sprite_component>(player_entity, SDL_Rect{x, y, player_width, player_height}, 0, 0, true);
+    commands.emplace<sprite_texture_component>(player_entity, sprite_texture);
+    commands.emplace<label_component>(player_entity, entity_label::player);
+    commands.emplace<sprite_character_animation_component>(player_entity, 1, 0, 0, first_sprite_index, last_sprite_index, padding);
+    commands.emplace<transform_component>(player_entity, x, y, 0, 0, to_fixed(4));
+    commands.emplace<collision_detection_component>(player_entity, 'F');
+    commands.emplace<collidable_component>(player_entity, true);
+    commands.emplace<hitpoints_component>(player_entity, 10, 10);
+    commands.emplace<life_bar_component>(player_entity, player_width, 8, SDL_Color{0, 255, 0, 255}, SDL_Rect{x, y, player_width, 8});
+    commands.emplace<combat_component>(player_entity, false, false, 10, 0, 0, 3000, game.get_clock().now());
+    commands.emplace<cooldown_component>(
         player_entity, cooldown_width, cooldown_height, 
         SDL_Color{0, 255, 0, 255}, SDL_Rect{cooldown_x_placement, cooldown_y_placement, 100, cooldown_height}, 
         SDL_Rect{(cooldown_x_placement - cooldown_border), (cooldown_y_placement - cooldown_border), (cooldown_width + (2 * cooldown_border)), (cooldown_height + (2 * cooldown_border))}
     );
-    game.get_registry().emplace<inventory_component>(player_entity);
-    game.get_registry().emplace<layer_two_component>(player_entity);
+    commands.emplace<inventory_component>(player_entity);
+    commands.emplace<layer_two_component>(player_entity);
 
 
     return player_entity;
 }
 
-entt::entity create_enemy(cwt::game &game, const char *texture_path, int x, int y) {
-    auto enemy_entity = game.get_registry().create();
+command_buffer::pending create_enemy(cwt::game &game, const char *texture_path, int x, int y) {
+    command_buffer &commands = game.get_commands();
+    auto enemy_entity = commands.create();
     int enemy_width = GameConfig::instance().grid_cell_width;
     int enemy_height = GameConfig::instance().grid_cell_height;
     
@@ -103,76 +119,82 @@ entt::entity create_enemy(cwt::game &game, const char *texture_path, int x, int
     int padding = 30;
     auto [src_w, src_h] = get_source_dimensions(game, texture_path, num_sprites_x, num_sprites_y);
 
-    game.get_registry().emplace<sprite_component>(enemy_entity, 
+    sprite_texture_component sprite_texture{
         128, 128,
-        SDL_Rect{0, 0, src_w, src_h}, 
-        SDL_Rect{x, y, enemy_width, enemy_height}, 
-        IMG_LoadTexture(game.get_renderer(), texture_path),
-        0, 0,
-        true,
-        std::string("ENEMY")
-    );
-    game.get_registry().emplace<sprite_character_animation_component>(enemy_entity, 1, 0, 0, first_sprite_index, last_sprite_index, padding);
-    game.get_registry().emplace<transform_component>(enemy_entity, x, y, 0, 0, 2);
-    game.get_registry().emplace<targetting_component>(enemy_entity);
-    game.get_registry().emplace<collision_detection_component>(enemy_entity, 'E');
-    game.get_registry().emplace<collidable_component>(enemy_entity, true);
-    game.get_registry().emplace<path_finding_component>(enemy_entity, SDL_GetTicks(), false);
-    game.get_registry().emplace<hitpoints_component>(enemy_entity, 10, 10);
-    game.get_registry().emplace<life_bar_component>(enemy_entity, enemy_width, 8, SDL_Color{0, 255, 0, 255}, SDL_Rect{x, y, enemy_width, 8});
-    game.get_registry().emplace<combat_component>(enemy_entity, true, false, 10, 0, 0, 3000, SDL_GetTicks());
-    game.get_registry().emplace<layer_two_component>(enemy_entity);
+        SDL_Rect{0, 0, src_w, src_h},
+        game.get_texture_cache().acquire(texture_path)
+    };
+    place_in_texture(game, sprite_texture, texture_path);
+
+    commands.emplace<sprite_component>(enemy_entity, SDL_Rect{x, y, enemy_width, enemy_height}, 0, 0, true);
+    commands.emplace<sprite_texture_component>(enemy_entity, sprite_texture);
+    commands.emplace<label_component>(enemy_entity, entity_label::enemy);
+    commands.emplace<sprite_character_animation_component>(enemy_entity, 1, 0, 0, first_sprite_index, last_sprite_index, padding);
+    commands.emplace<transform_component>(enemy_entity, x, y, 0, 0, to_fixed(1));
+    commands.emplace<targetting_component>(enemy_entity);
+    commands.emplace<collision_detection_component>(enemy_entity, 'E');
+    commands.emplace<collidable_component>(enemy_entity, true);
+    commands.emplace<path_finding_component>(enemy_entity, game.get_clock().now(), false);
+    commands.emplace<hitpoints_component>(enemy_entity, 10, 10);
+    commands.emplace<life_bar_component>(enemy_entity, enemy_width, 8, SDL_Color{0, 255, 0, 255}, SDL_Rect{x, y, enemy_width, 8});
+    commands.emplace<combat_component>(enemy_entity, true, false, 10, 0, 0, 3000, game.get_clock().now());
+    commands.emplace<layer_two_component>(enemy_entity);
 
     return enemy_entity;
 }
 
-entt::entity create_weapon(cwt::game &game, const char *texture_path, int x, int y, entt::entity char_entity) {
-    auto weapon_entity = game.get_registry().create();
+// The owner may not exist yet either, so its side, (F)riendly or (E)nemy as in its
+// collision_detection_component, is passed in for the weapon's damage
+command_buffer::pending create_weapon(cwt::game &game, const char *texture_path, int x, int y, command_buffer::pending char_entity, char char_type) {
+    command_buffer &commands = game.get_commands();
+    auto weapon_entity = commands.create();
     int weapon_width = GameConfig::instance().grid_cell_width;
     int weapon_height = GameConfig::instance().grid_cell_height;
-    auto collision_detection_char = game.get_registry().try_get<collision_detection_component>(char_entity);
 
-    game.get_registry().emplace<weapon_component>(weapon_entity, char_entity);
-    game.get_registry().emplace<damage_component>(weapon_entity, 1, false, false, false, true, collision_detection_char->type);
-    game.get_registry().emplace<sprite_component>(weapon_entity,
+    sprite_texture_component sprite_texture{
         325, 743,
-        SDL_Rect{0, 0, 325, 743}, 
-        SDL_Rect{x, y, weapon_width, weapon_height},
-        IMG_LoadTexture(game.get_renderer(), texture_path),
-        0, 0,
-        false,
-        std::string("WEAPON")
-    );
-    game.get_registry().emplace<transform_component>(weapon_entity, x, y, 0, 0);
-    game.get_registry().emplace<collidable_component>(weapon_entity, false);
-    game.get_registry().emplace<layer_one_component>(weapon_entity);
+        SDL_Rect{0, 0, 325, 743},
+        game.get_texture_cache().acquire(texture_path)
+    };
+    place_in_texture(game, sprite_texture, texture_path);
+
+    commands.emplace<weapon_component>(weapon_entity, char_entity);
+    commands.emplace<damage_component>(weapon_entity, 1, false, false, false, true, char_type);
+    commands.emplace<sprite_component>(weapon_entity, SDL_Rect{x, y, weapon_width, weapon_height}, 0, 0, false);
+    commands.emplace<sprite_texture_component>(weapon_entity, sprite_texture);
+    commands.emplace<label_component>(weapon_entity, entity_label::weapon);
+    commands.emplace<transform_component>(weapon_entity, x, y, 0, 0);
+    commands.emplace<collidable_component>(weapon_entity, false);
+    commands.emplace<layer_one_component>(weapon_entity);
 
     return weapon_entity;
 }
 
-entt::entity create_item(cwt::game &game, const char *texture_path, int x, int y, std::string item_name) {
-    auto item_entity = game.get_registry().create();
+command_buffer::pending create_item(cwt::game &game, const char *texture_path, int x, int y, std::string item_name) {
+    command_buffer &commands = game.get_commands();
+    auto item_entity = commands.create();
     int item_width = GameConfig::instance().grid_cell_width;
     int item_height = GameConfig::instance().grid_cell_height;
 
-    game.get_registry().emplace<sprite_component>(item_entity, 
+    sprite_texture_component sprite_texture{
         512, 512,
-        SDL_Rect{0, 0, 512, 512}, 
-        SDL_Rect{x, y, item_width, item_height}, 
-        IMG_LoadTexture(game.get_renderer(), texture_path),
-        0, 0,
-        true,
-        std::string("ITEM")
-    );
-    game.get_registry().emplace<transform_component>(item_entity, x, y, 0, 0, 0);
-    game.get_registry().emplace<collidable_component>(item_entity, true);
-    game.get_registry().emplace<item_component>(item_entity, item_name);
-    game.get_registry().emplace<layer_two_component>(item_entity);
+        SDL_Rect{0, 0, 512, 512},
+        game.get_texture_cache().acquire(texture_path)
+    };
+    place_in_texture(game, sprite_texture, texture_path);
+
+    commands.emplace<sprite_component>(item_entity, SDL_Rect{x, y, item_width, item_height}, 0, 0, true);
+    commands.emplace<sprite_texture_component>(item_entity, sprite_texture);
+    commands.emplace<label_component>(item_entity, entity_label::item);
+    commands.emplace<transform_component>(item_entity, x, y, 0, 0, to_fixed(0));
+    commands.emplace<collidable_component>(item_entity, true);
+    commands.emplace<item_component>(item_entity, std::move(item_name));
+    commands.emplace<layer_two_component>(item_entity);
 
     return item_entity;
 }
 
-entt::entity create_scenery_animated(
+command_buffer::pending create_scenery_animated(
     cwt::game &game, 
     const char *texture_path, 
     int num_sprites_x, 
@@ -181,25 +203,27 @@ entt::entity create_scenery_animated(
     int pixel_offset
 ) 
 {
-    auto scenery_entity = game.get_registry().create();
+    command_buffer &commands = game.get_commands();
+    auto scenery_entity = commands.create();
     int scenery_width = GameConfig::instance().grid_cell_width;
     int scenery_height = GameConfig::instance().grid_cell_height;
 
     auto [src_w, src_h] = get_source_dimensions(game, texture_path, num_sprites_x, num_sprites_y);
 
-    game.get_registry().emplace<sprite_component>(scenery_entity, 
+    sprite_texture_component sprite_texture{
         src_w, src_h,
-        SDL_Rect{0, 0, src_w, src_h}, 
-        SDL_Rect{x, y, scenery_width * 2, scenery_height * 2},
-        IMG_LoadTexture(game.get_renderer(), texture_path),
-        0, 0,
-        true,
-        std::string("SCENERY")
-    );
-    game.get_registry().emplace<sprite_scenery_animation_component>(scenery_entity, 0, 0, num_sprites_x, pixel_offset);
-    game.get_registry().emplace<transform_component>(scenery_entity, x, y, 0, 0, 0);
-    game.get_registry().emplace<collidable_component>(scenery_entity, true);
-    game.get_registry().emplace<layer_two_component>(scenery_entity);
+        SDL_Rect{0, 0, src_w, src_h},
+        game.get_texture_cache().acquire(texture_path)
+    };
+    place_in_texture(game, sprite_texture, texture_path);
+
+    commands.emplace<sprite_component>(scenery_entity, SDL_Rect{x, y, scenery_width * 2, scenery_height * 2}, 0, 0, true);
+    commands.emplace<sprite_texture_component>(scenery_entity, sprite_texture);
+    commands.emplace<label_component>(scenery_entity, entity_label::scenery);
+    commands.emplace<sprite_scenery_animation_component>(scenery_entity, 0, 0, num_sprites_x, pixel_offset);
+    commands.emplace<transform_component>(scenery_entity, x, y, 0, 0, to_fixed(0));
+    commands.emplace<collidable_component>(scenery_entity, true);
+    commands.emplace<layer_two_component>(scenery_entity);
 
     return scenery_entity;
 }
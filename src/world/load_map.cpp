@@ -1,82 +1,146 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <algorithm>
 
 #include <entt/entt.hpp>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
-#include "../components/transform.h"
-#include "../components/sprite.h"
-#include "../components/render_layer.h"
-#include "../components/collidable.h"
-#include "../systems/sprite.cpp"
+#include "../components/tilemap.h"
+#include "texture_cache.hpp"
+#include "map_format.hpp"
+#include "mapped_file.hpp"
 
 #include "../config/game_config.h"
 
 
-void load_map(const std::string& filename, entt::registry& registry, SDL_Renderer* renderer)
+// Size of a loaded map in grid cells
+struct map_dimensions {
+    int columns = 0;
+    int rows = 0;
+};
+
+// What each tile_id looks like, textures come from (and are held in) textures
+std::vector<tile_type> make_tile_palette(texture_cache& textures)
+{
+    auto textured = [&](const std::string& path, bool collidable) {
+        tile_type type;
+        type.texture = textures.acquire(path);
+        if (!type.texture && textures.renderer) {
+            std::cerr << "Error loading texture for tile: " << SDL_GetError() << '\n';
+        }
+        const SDL_Point origin = textures.origin(path);
+        type.src = SDL_Rect{20 + origin.x, 20 + origin.y, 250, 250};
+        type.collidable = collidable;
+        return type;
+    };
+
+    std::vector<tile_type> palette(3);
+    palette[tile_wall] = textured("assets/images/wall.jpg", true);
+    palette[tile_floor] = textured("assets/images/brick.jpg", false);
+    return palette;
+}
+
+// An empty tilemap the size of the map with the game's palette
+tilemap_component make_tilemap(texture_cache& textures, int columns, int rows, int layers)
+{
+    tilemap_component tilemap;
+    tilemap.columns = columns;
+    tilemap.rows = rows;
+    tilemap.layers = layers;
+    tilemap.tile_width = GameConfig::instance().grid_cell_width;
+    tilemap.tile_height = GameConfig::instance().grid_cell_height;
+    tilemap.tiles.assign(static_cast<std::size_t>(layers) * rows * columns, tile_empty);
+    tilemap.blocked.assign(static_cast<std::size_t>(rows) * columns, 0);
+    tilemap.palette = make_tile_palette(textures);
+    return tilemap;
+}
+
+// Works out tilemap.blocked from the tiles and puts the finished map on an entity of its own
+map_dimensions add_tilemap(entt::registry& registry, tilemap_component&& tilemap)
+{
+    for (int layer = 0; layer < tilemap.layers; ++layer) {
+        for (int row = 0; row < tilemap.rows; ++row) {
+            for (int col = 0; col < tilemap.columns; ++col) {
+                const std::uint16_t tile = tilemap.at(layer, col, row);
+                if (tile < tilemap.palette.size() && tilemap.palette[tile].collidable) {
+                    tilemap.blocked[row * tilemap.columns + col] = 1;
+                }
+            }
+        }
+    }
+    const map_dimensions dimensions{tilemap.columns, tilemap.rows};
+    registry.emplace<tilemap_component>(registry.create(), std::move(tilemap));
+    return dimensions;
+}
+
+// Loads a map.txt, 'd' for walls and 'g' for floor. The game loads the binary form
+// instead (see load_map_file), this is for tools and generated maps.
+map_dimensions load_map(const std::string& filename, entt::registry& registry, texture_cache& textures)
 {   
     std::ifstream map_file(filename);
     if (!map_file.is_open()) {
         std::cerr << "Error: Could not open map file " << filename << '\n';
-        return;
+        return map_dimensions{};
     }
-    const int tile_width = GameConfig::instance().grid_cell_width;
-    const int tile_height = GameConfig::instance().grid_cell_height;
-    int row = 0;
-
-    sprite_system sprite_system_inst;
-    SDL_Texture* wall_texture = IMG_LoadTexture(renderer, "assets/images/wall.jpg");
-    SDL_Texture* brick_texture = IMG_LoadTexture(renderer, "assets/images/brick.jpg");
 
+    std::vector<std::string> lines;
     std::string line;
+    int columns = 0;
     while (std::getline(map_file, line)) {
-        for (int col = 0; col < line.size(); ++col) {
-            char tile = line[col];
-            if (tile == 'd' || tile == 'g') {
-                // Create entity for this tile
-                entt::entity entity = registry.create();
-
-                // Assign sprite component
-                sprite_component& sprite = registry.emplace<sprite_component>(entity);
-                registry.emplace<background_component>(entity);
-
-                sprite.visible = true;
-                sprite.label = std::string("TERRAIN");
-                // The image being used for the sprite
-                sprite.src_w = 250;
-                sprite.src_h = 250;
-                sprite.src.x = 20;
-                sprite.src.y = 20;
-                sprite.src.w = 250;
-                sprite.src.h = 250;
-
-                sprite.dst.x = col * tile_width;
-                sprite.dst.y = row * tile_height;
-                sprite.dst.w = tile_width;
-                sprite.dst.h = tile_height;
-
-                auto [grid_x, grid_y] = sprite_system_inst.get_grid_position(sprite.dst.x, sprite.dst.y);
-                sprite.grid_x = grid_x;
-                sprite.grid_y = grid_y;
-
-                // Load texture based on tile type
-                if (tile == 'd') {
-                    sprite.texture = wall_texture;
-                    registry.emplace<collidable_component>(entity, true);
-                    std::cout << "Loaded DIRT" << std::endl;
-                } else if (tile == 'g') {
-                    sprite.texture = brick_texture;
-                    std::cout << "Loaded GRASS" << std::endl;
-                }
+        columns = std::max(columns, static_cast<int>(line.size()));
+        lines.push_back(line);
+    }
+
+    tilemap_component tilemap = make_tilemap(textures, columns, static_cast<int>(lines.size()), 1);
+    for (int row = 0; row < tilemap.rows; ++row) {
+        for (int col = 0; col < static_cast<int>(lines[row].size()); ++col) {
+            tilemap.tiles[row * columns + col] = tile_from_char(lines[row][col]);
+        }
+    }
+    return add_tilemap(registry, std::move(tilemap));
+}
+
+// Loads a binary map made by tools/map_converter.cpp (see map_format.hpp). The file is
+// memory mapped and every chunk is decoded into the tilemap up front, so the whole map is
+// resident for as long as it is loaded.
+map_dimensions load_map_file(const std::string& filename, entt::registry& registry, texture_cache& textures)
+{
+    mapped_file file;
+    if (!file.open(filename) || file.size() < map_file_header_size) {
+        std::cerr << "Error: Could not open map file " << filename << '\n';
+        return map_dimensions{};
+    }
+    const map_file_header header = decode_map_header(file.data());
+    if (!valid_map_header(header, file.size())) {
+        std::cerr << "Error: " << filename << " is not a version " << map_file_version << " map file\n";
+        return map_dimensions{};
+    }
 
-                if (!sprite.texture) {
-                    std::cerr << "Error loading texture for tile: " << SDL_GetError() << '\n';
+    const int columns = static_cast<int>(header.columns), rows = static_cast<int>(header.rows);
+    const int size = static_cast<int>(header.chunk_size);
+    tilemap_component tilemap = make_tilemap(textures, columns, rows, static_cast<int>(header.layers));
+    for (int layer = 0; layer < tilemap.layers; ++layer) {
+        for (int chunk_y = 0; chunk_y < static_cast<int>(header.chunks_y); ++chunk_y) {
+            for (int chunk_x = 0; chunk_x < static_cast<int>(header.chunks_x); ++chunk_x) {
+                const std::byte* chunk = file.data() + map_chunk_offset(header, chunk_x, chunk_y, layer);
+                const int width = std::min(size, columns - chunk_x * size);
+                for (int y = 0; y < std::min(size, rows - chunk_y * size); ++y) {
+                    const std::size_t row = static_cast<std::size_t>(layer) * rows + chunk_y * size + y;
+                    const std::byte* source = chunk + y * size * sizeof(std::uint16_t);
+                    std::uint16_t* destination = &tilemap.tiles[row * columns + chunk_x * size];
+                    for (int x = 0; x < width; ++x) {
+                        destination[x] = read_le16(source + x * sizeof(std::uint16_t));
+                    }
                 }
             }
         }
-        ++row;
     }
-}
\ No newline at end of file
+    return add_tilemap(registry, std::move(tilemap));
+}
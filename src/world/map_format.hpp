@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary map (.bin) written by tools/map_converter.cpp and read by load_map_file().
+//
+//   map_file_header, map_file_header_size bytes: the magic then each field as a
+//   little endian 32 bit integer, in the order below
+//   chunks, row by row of chunks, each holding every layer in turn as
+//   chunk_size * chunk_size little endian tile ids, row by row
+//
+// Everything is written and read a byte at a time (encode_map_header, read_le16...), so
+// files are the same whatever the byte order of the machine that made or reads them.
+//
+// Chunks on the right and bottom edges are padded with tile_empty, so any chunk's tiles
+// can be found from its coordinates without reading anything else. The game does not
+// stream them: load_map_file() reads every chunk into one tilemap when the map loads and
+// the whole map stays in memory after that. The chunks are there so tools can read or
+// patch a region of a map without going through the rest of it.
+struct map_file_header {
+    char magic[4];              // "DQMP"
+    std::uint32_t version;
+    std::uint32_t columns;      // Map size in tiles
+    std::uint32_t rows;
+    std::uint32_t chunk_size;   // Chunk width and height in tiles
+    std::uint32_t layers;       // Layer 0 is the ground, later layers sit on top of it
+    std::uint32_t chunks_x;     // Chunks across and down, rounded up
+    std::uint32_t chunks_y;
+};
+
+constexpr std::uint32_t map_file_version = 1;
+constexpr std::uint32_t map_file_default_chunk_size = 32;
+constexpr std::size_t map_file_header_size = 32;
+
+// Byte is unsigned char or std::byte
+template <typename Byte>
+std::uint16_t read_le16(const Byte* bytes)
+{
+    return static_cast<std::uint16_t>(static_cast<std::uint16_t>(bytes[0]) | static_cast<std::uint16_t>(bytes[1]) << 8);
+}
+
+template <typename Byte>
+std::uint32_t read_le32(const Byte* bytes)
+{
+    return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8
+        | static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+inline void write_le32(unsigned char* bytes, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<unsigned char>(value >> (i * 8));
+    }
+}
+
+inline void encode_map_header(const map_file_header& header, unsigned char* bytes)
+{
+    std::memcpy(bytes, header.magic, 4);
+    const std::uint32_t fields[] = {header.version, header.columns, header.rows, header.chunk_size, header.layers, header.chunks_x, header.chunks_y};
+    for (std::size_t i = 0; i < 7; ++i) {
+        write_le32(bytes + 4 + i * 4, fields[i]);
+    }
+}
+
+// bytes holds at least map_file_header_size bytes
+template <typename Byte>
+map_file_header decode_map_header(const Byte* bytes)
+{
+    map_file_header header{};
+    std::memcpy(header.magic, bytes, 4);
+    std::uint32_t* fields[] = {&header.version, &header.columns, &header.rows, &header.chunk_size, &header.layers, &header.chunks_x, &header.chunks_y};
+    for (std::size_t i = 0; i < 7; ++i) {
+        *fields[i] = read_le32(bytes + 4 + i * 4);
+    }
+    return header;
+}
+
+// What can be in a map cell, 0 leaves the cell empty on that layer
+enum tile_id : std::uint16_t {
+    tile_empty = 0,
+    tile_wall = 1,   // 'd' in map.txt, blocks movement
+    tile_floor = 2,  // 'g' in map.txt
+};
+
+inline tile_id tile_from_char(char tile)
+{
+    switch (tile) {
+        case 'd': return tile_wall;
+        case 'g': return tile_floor;
+        default: return tile_empty;
+    }
+}
+
+inline bool valid_map_header(const map_file_header& header, std::size_t file_size)
+{
+    if (std::memcmp(header.magic, "DQMP", 4) != 0 || header.version != map_file_version
+        || header.chunk_size == 0 || header.columns == 0 || header.rows == 0 || header.layers == 0) {
+        return false;
+    }
+    const std::size_t chunk_tiles = static_cast<std::size_t>(header.chunk_size) * header.chunk_size;
+    return header.chunks_x == (header.columns + header.chunk_size - 1) / header.chunk_size
+        && header.chunks_y == (header.rows + header.chunk_size - 1) / header.chunk_size
+        && file_size >= map_file_header_size + static_cast<std::size_t>(header.chunks_x) * header.chunks_y * header.layers * chunk_tiles * sizeof(std::uint16_t);
+}
+
+// Offset in bytes of one layer of a chunk from the start of the file
+inline std::size_t map_chunk_offset(const map_file_header& header, std::uint32_t chunk_x, std::uint32_t chunk_y, std::uint32_t layer)
+{
+    const std::size_t chunk_tiles = static_cast<std::size_t>(header.chunk_size) * header.chunk_size;
+    const std::size_t chunk_index = static_cast<std::size_t>(chunk_y) * header.chunks_x + chunk_x;
+    return map_file_header_size + (chunk_index * header.layers + layer) * chunk_tiles * sizeof(std::uint16_t);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#if defined(_WIN32)
+#include <vector>
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// A read only file mapped into memory, pages are only read from disk when touched.
+// Falls back to reading the whole file where there is no mmap.
+struct mapped_file
+{
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file()
+    {
+        close();
+    }
+
+    bool open(const std::string& path)
+    {
+        close();
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        m_buffer.resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        return static_cast<bool>(file);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* memory = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps the file open
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        m_data = static_cast<const std::byte*>(memory);
+        m_size = static_cast<std::size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        m_buffer.clear();
+#else
+        if (m_data) {
+            munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const std::byte* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+#if defined(_WIN32)
+    std::vector<std::byte> m_buffer;
+#endif
+};
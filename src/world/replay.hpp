@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <entt/entt.hpp>
+
+#include "../components/transform.h"
+#include "../components/sprite.h"
+#include "../components/health.h"
+#include "../components/combat.h"
+#include "../components/input.h"
+
+// Records the input of every frame to a file (one line per frame) and plays it back.
+// Combined with a fixed step simulation_clock two runs of the same file end up with
+// the same registry state, which registry_checksum() can confirm.
+struct input_replay
+{
+    std::ofstream record_file;
+    std::ifstream replay_file;
+
+    bool start_recording(const std::string& filename)
+    {
+        record_file.open(filename, std::ios::trunc);
+        return record_file.is_open();
+    }
+
+    bool start_replay(const std::string& filename)
+    {
+        replay_file.open(filename);
+        return replay_file.is_open();
+    }
+
+    bool recording() const { return record_file.is_open(); }
+    bool replaying() const { return replay_file.is_open(); }
+
+    void record(const input_state& input)
+    {
+        record_file << static_cast<int>(input.to_bits()) << '\n';
+    }
+
+    // Returns false once the recording has run out of frames
+    bool read(input_state& input)
+    {
+        int bits = 0;
+        if (!(replay_file >> bits)) {
+            return false;
+        }
+        input = input_state::from_bits(static_cast<std::uint8_t>(bits));
+        return true;
+    }
+};
+
+// FNV-1a over the simulation state that matters for gameplay.
+// Used to check that a replayed or headless run ends up where the original did.
+inline std::uint64_t registry_checksum(entt::registry& reg)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](std::int64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= static_cast<std::uint8_t>(value >> (i * 8));
+            hash *= 1099511628211ull;
+        }
+    };
+
+    auto view_transform = reg.view<transform_component>();
+    view_transform.each([&](entt::entity entity, transform_component &transform) {
+        mix(static_cast<std::int64_t>(entt::to_integral(entity)));
+        mix(transform.pos_x);
+        mix(transform.pos_y);
+        mix(transform.vel_x);
+        mix(transform.vel_y);
+        mix(transform.move_x);
+        mix(transform.move_y);
+        mix(transform.sub_x);
+        mix(transform.sub_y);
+        mix(static_cast<std::int64_t>(transform.direction));
+    });
+
+    auto view_sprite = reg.view<sprite_component>();
+    view_sprite.each([&](entt::entity entity, sprite_component &sprite) {
+        mix(static_cast<std::int64_t>(entt::to_integral(entity)));
+        mix(sprite.grid_x);
+        mix(sprite.grid_y);
+        mix(sprite.visible);
+    });
+
+    auto view_hitpoints = reg.view<hitpoints_component>();
+    view_hitpoints.each([&](entt::entity entity, hitpoints_component &hitpoints) {
+        mix(static_cast<std::int64_t>(entt::to_integral(entity)));
+        mix(hitpoints.hitpoints);
+        mix(hitpoints.stunned_frames_remaining);
+    });
+
+    auto view_combat = reg.view<combat_component>();
+    view_combat.each([&](entt::entity entity, combat_component &combat) {
+        mix(static_cast<std::int64_t>(entt::to_integral(entity)));
+        mix(combat.attacking);
+        mix(combat.attack_frames_remaining);
+        mix(combat.last_strike);
+    });
+
+    return hash;
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include <entt/entt.hpp>
+
+#include "../systems/logging/performance_logging.cpp"
+
+// Resources that are not components but still need ordering between systems
+struct console_resource{ };  // std::cout, so lines from different systems never interleave
+
+// Creates every pool up front. EnTT makes a pool the first time a type is used, which is
+// not safe while other threads are reading the registry.
+template <typename... Components>
+void prewarm_storage(entt::registry& reg)
+{
+    (reg.storage<Components>(), ...);
+}
+
+// Runs the frame's systems on a pool of threads.
+// Each system is added in the order the single threaded game ran it, together with the
+// component types it reads and writes. A system waits for every earlier one it conflicts
+// with (one writes what the other reads or writes) and exclusive systems, the ones that
+// create or destroy entities, wait for and block everything. Whatever is left over runs
+// at the same time. Ready systems go on the deque of the thread that freed them and idle
+// threads steal from the others. The calling thread works too, so one thread in total
+// runs everything in the original order. A running system can split its own loop across
+// the same threads with parallel_for().
+struct system_scheduler
+{
+    using resource_list = std::vector<entt::id_type>;
+
+    template <typename... Types>
+    static resource_list resources()
+    {
+        return {entt::type_hash<Types>::value()...};
+    }
+
+    struct task {
+        const char* name;
+        resource_list reads;
+        resource_list writes;
+        bool exclusive;
+        std::function<void()> work;
+        std::vector<std::size_t> dependents;
+        int dependency_count = 0;
+    };
+
+    performance_logging_system* profiler = nullptr; // Times every task when set
+
+    ~system_scheduler()
+    {
+        stop();
+    }
+
+    void add(const char* name, resource_list reads, resource_list writes, std::function<void()> work)
+    {
+        m_tasks.push_back({name, std::move(reads), std::move(writes), false, std::move(work), {}, 0});
+        m_built = false;
+    }
+
+    // For systems that change the registry's structure (create, destroy, emplace, remove)
+    void add_exclusive(const char* name, std::function<void()> work)
+    {
+        m_tasks.push_back({name, {}, {}, true, std::move(work), {}, 0});
+        m_built = false;
+    }
+
+    // Total threads including the caller, 0 for one per hardware thread
+    void start(unsigned thread_count)
+    {
+        stop();
+        if (thread_count == 0) {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_queues.clear();
+        for (unsigned i = 0; i < thread_count; ++i) {
+            m_queues.push_back(std::make_unique<work_queue>());
+        }
+        m_stopping = false;
+        for (unsigned i = 1; i < thread_count; ++i) {
+            m_workers.emplace_back(&system_scheduler::worker_loop, this, i);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+    }
+
+    std::size_t thread_count() const { return std::max<std::size_t>(m_queues.size(), 1); }
+
+    // Runs every task once and returns when they have all finished
+    void run()
+    {
+        if (m_queues.empty()) {
+            start(1);
+        }
+        if (!m_built) {
+            build();
+        }
+        if (m_tasks.empty()) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < m_tasks.size(); ++i) {
+            m_remaining[i].store(m_tasks[i].dependency_count, std::memory_order_relaxed);
+        }
+        m_unfinished.store(static_cast<int>(m_tasks.size()));
+
+        t_thread = 0;
+        for (std::size_t i = 0; i < m_tasks.size(); ++i) {
+            if (m_tasks[i].dependency_count == 0) {
+                push(0, job{i, nullptr, 0});
+            }
+        }
+        work_until(0, [&] { return m_unfinished.load() == 0; });
+    }
+
+    // Calls body(begin, end, thread) over chunks of [0, count) on the scheduler's threads and
+    // returns when all are done. thread is below thread_count() and no two chunks running at
+    // the same time share one, so it can index per thread scratch space. Runs inline when
+    // there is one thread or little work.
+    template <typename Body>
+    void parallel_for(std::size_t count, std::size_t min_chunk, Body&& body)
+    {
+        const std::size_t thread = current_thread();
+        if (m_queues.size() <= 1 || count <= min_chunk || thread >= m_queues.size()) {
+            body(std::size_t{0}, count, std::min(thread, thread_count() - 1));
+            return;
+        }
+
+        parallel_batch batch;
+        batch.body = [&body](std::size_t begin, std::size_t end, std::size_t worker) { body(begin, end, worker); };
+        const std::size_t chunks = std::min((count + min_chunk - 1) / min_chunk, m_queues.size() * 4);
+        batch.chunk_size = (count + chunks - 1) / chunks;
+        batch.count = count;
+        batch.remaining.store(static_cast<int>(chunks));
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            push(thread, job{0, &batch, chunk});
+        }
+        work_until(thread, [&] { return batch.remaining.load() == 0; });
+    }
+
+    // The dependency graph, one line per system listing what it waits for
+    void describe(std::ostream& out)
+    {
+        if (!m_built) {
+            build();
+        }
+        for (std::size_t i = 0; i < m_tasks.size(); ++i) {
+            out << m_tasks[i].name << " <-";
+            for (std::size_t j = 0; j < i; ++j) {
+                const auto& dependents = m_tasks[j].dependents;
+                if (std::find(dependents.begin(), dependents.end(), i) != dependents.end()) {
+                    out << ' ' << m_tasks[j].name;
+                }
+            }
+            out << '\n';
+        }
+    }
+
+private:
+    struct parallel_batch {
+        std::function<void(std::size_t, std::size_t, std::size_t)> body;
+        std::size_t count = 0;
+        std::size_t chunk_size = 0;
+        std::atomic<int> remaining{0};
+    };
+
+    // Either a whole task or one chunk of a parallel_for
+    struct job {
+        std::size_t task;
+        parallel_batch* batch;
+        std::size_t chunk;
+    };
+
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<job> jobs;
+    };
+
+    std::vector<task> m_tasks;
+    std::unique_ptr<std::atomic<int>[]> m_remaining; // Unfinished dependencies per task this run
+    bool m_built = false;
+
+    std::vector<std::unique_ptr<work_queue>> m_queues; // One per thread, index 0 is the caller
+    std::vector<std::thread> m_workers;
+    std::atomic<int> m_unfinished{0};
+    std::atomic<int> m_queued{0};
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopping{false};
+
+    static bool overlaps(const resource_list& a, const resource_list& b)
+    {
+        for (entt::id_type id : a) {
+            if (std::find(b.begin(), b.end(), id) != b.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool conflicts(const task& earlier, const task& later)
+    {
+        return earlier.exclusive || later.exclusive
+            || overlaps(earlier.writes, later.reads) || overlaps(earlier.writes, later.writes)
+            || overlaps(earlier.reads, later.writes);
+    }
+
+    // Every earlier task a task conflicts with becomes one of its dependencies
+    void build()
+    {
+        for (task& current : m_tasks) {
+            current.dependents.clear();
+            current.dependency_count = 0;
+        }
+        for (std::size_t later = 0; later < m_tasks.size(); ++later) {
+            for (std::size_t earlier = 0; earlier < later; ++earlier) {
+                if (conflicts(m_tasks[earlier], m_tasks[later])) {
+                    m_tasks[earlier].dependents.push_back(later);
+                    m_tasks[later].dependency_count += 1;
+                }
+            }
+        }
+        m_remaining = std::make_unique<std::atomic<int>[]>(m_tasks.size());
+        m_built = true;
+    }
+
+    // Index of the calling thread's queue, npos off the scheduler's threads
+    static inline thread_local std::size_t t_thread = static_cast<std::size_t>(-1);
+
+    static std::size_t current_thread() { return t_thread; }
+
+    void push(std::size_t queue_index, job ready)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queues[queue_index]->mutex);
+            m_queues[queue_index]->jobs.push_back(ready);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queued += 1;
+        }
+        m_wake.notify_one();
+    }
+
+    // Newest from our own deque, otherwise the oldest from someone else's
+    bool pop(std::size_t queue_index, job& next)
+    {
+        {
+            work_queue& own = *m_queues[queue_index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                next = own.jobs.back();
+                own.jobs.pop_back();
+                m_queued -= 1;
+                return true;
+            }
+        }
+        for (std::size_t offset = 1; offset < m_queues.size(); ++offset) {
+            work_queue& victim = *m_queues[(queue_index + offset) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                next = victim.jobs.front();
+                victim.jobs.pop_front();
+                m_queued -= 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(std::size_t queue_index, const job& next)
+    {
+        if (next.batch) {
+            parallel_batch& batch = *next.batch;
+            const std::size_t begin = next.chunk * batch.chunk_size;
+            batch.body(begin, std::min(begin + batch.chunk_size, batch.count), queue_index);
+            if (batch.remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_wake.notify_all(); // Whoever called parallel_for can carry on
+            }
+            return;
+        }
+
+        task& current = m_tasks[next.task];
+        if (profiler) {
+            profiler->measure(current.name, current.work);
+        } else {
+            current.work();
+        }
+
+        for (std::size_t dependent : current.dependents) {
+            if (m_remaining[dependent].fetch_sub(1) == 1) {
+                push(queue_index, job{dependent, nullptr, 0});
+            }
+        }
+        if (m_unfinished.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_all(); // The frame is done
+        }
+    }
+
+    // Works on whatever is queued, sleeping when there is nothing, until done() holds
+    template <typename Done>
+    void work_until(std::size_t queue_index, Done&& done)
+    {
+        while (!done()) {
+            job next;
+            if (pop(queue_index, next)) {
+                execute(queue_index, next);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_queued.load() > 0 || done(); });
+        }
+    }
+
+    void worker_loop(std::size_t queue_index)
+    {
+        t_thread = queue_index;
+        work_until(queue_index, [&] { return m_stopping.load(); });
+    }
+};
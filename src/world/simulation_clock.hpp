@@ -0,0 +1,30 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include "../config/game_config.h"
+
+// Source of "now" for every system that cares about time.
+// In realtime mode it just follows SDL_GetTicks(). In fixed step mode time only
+// moves when the game loop advances it, one frame_delay per frame, so a run can
+// go as fast as the CPU allows and still see exactly the same timings each time.
+struct simulation_clock
+{
+    bool fixed_step = false;
+    Uint32 step_ms = GameConfig::instance().frame_delay;
+    Uint32 elapsed_ms = 0;   // Simulated time since start (fixed step only)
+    Uint32 frame = 0;        // Frames simulated so far
+
+    Uint32 now() const
+    {
+        return fixed_step ? elapsed_ms : SDL_GetTicks();
+    }
+
+    void advance()
+    {
+        frame += 1;
+        if (fixed_step) {
+            elapsed_ms += step_ms;
+        }
+    }
+};
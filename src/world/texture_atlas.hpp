@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+// Packs many images into a few large page textures at startup.
+// Sprites whose image is packed draw from the shared page, so the renderer can batch
+// everything on a page into one call. Pages are as wide as the renderer allows (capped at
+// page_width) and only as tall as their contents. Images wider than a page are left out
+// and loaded on their own by texture_cache as before.
+struct texture_atlas
+{
+    struct region {
+        SDL_Texture* page = nullptr;
+        SDL_Rect rect{0, 0, 0, 0};
+    };
+
+    static constexpr int page_width = 4096;
+    static constexpr int padding = 1; // Keeps neighbours from bleeding in when filtering
+
+    std::vector<SDL_Texture*> pages;
+    std::unordered_map<std::string, region> regions;
+
+    const region* find(const std::string& path) const
+    {
+        auto found = regions.find(path);
+        return found == regions.end() ? nullptr : &found->second;
+    }
+
+    // Shelf packing: tallest images first, left to right, a new shelf when a row fills up
+    // and a new page when the page is full
+    void build(SDL_Renderer* renderer, const std::vector<std::string>& paths)
+    {
+        if (!renderer) {
+            return;
+        }
+
+        SDL_RendererInfo info;
+        int max_size = page_width;
+        if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0) {
+            max_size = std::min({page_width, info.max_texture_width, info.max_texture_height});
+        }
+
+        std::vector<SDL_Surface*> surfaces;
+        std::vector<std::string> loaded_paths;
+        for (const std::string& path : paths) {
+            SDL_Surface* loaded = IMG_Load(path.c_str());
+            if (!loaded) {
+                SDL_Log("Atlas could not load %s: %s", path.c_str(), SDL_GetError());
+                continue;
+            }
+            SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(loaded);
+            if (!converted) {
+                continue;
+            }
+            if (converted->w + 2 * padding > max_size || converted->h + 2 * padding > max_size) {
+                SDL_FreeSurface(converted); // Too big to share a page, texture_cache loads it alone
+                continue;
+            }
+            surfaces.push_back(converted);
+            loaded_paths.push_back(path);
+        }
+
+        std::vector<std::size_t> order(surfaces.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return surfaces[a]->h > surfaces[b]->h;
+        });
+
+        // Work out placements first so each page is created at its final height
+        struct placement { std::size_t image; int page; int x; int y; };
+        std::vector<placement> placements;
+        std::vector<int> page_heights;
+        int page = 0, shelf_x = 0, shelf_y = 0, shelf_height = 0;
+        page_heights.push_back(0);
+        for (std::size_t image : order) {
+            const int w = surfaces[image]->w + 2 * padding;
+            const int h = surfaces[image]->h + 2 * padding;
+            if (shelf_x + w > max_size) { // Next shelf
+                shelf_y += shelf_height;
+                shelf_x = 0;
+                shelf_height = 0;
+            }
+            if (shelf_y + h > max_size) { // Next page
+                page += 1;
+                page_heights.push_back(0);
+                shelf_x = shelf_y = shelf_height = 0;
+            }
+            placements.push_back({image, page, shelf_x, shelf_y});
+            shelf_x += w;
+            shelf_height = std::max(shelf_height, h);
+            page_heights[page] = std::max(page_heights[page], shelf_y + h);
+        }
+
+        std::vector<SDL_Surface*> page_surfaces;
+        for (int height : page_heights) {
+            page_surfaces.push_back(height > 0 ? SDL_CreateRGBSurfaceWithFormat(0, max_size, height, 32, SDL_PIXELFORMAT_RGBA32) : nullptr);
+        }
+
+        for (const placement& placed : placements) {
+            SDL_Surface* target = page_surfaces[placed.page];
+            if (!target) {
+                continue;
+            }
+            SDL_Surface* image = surfaces[placed.image];
+            SDL_Rect destination{placed.x + padding, placed.y + padding, image->w, image->h};
+            SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE); // Copy alpha as is
+            SDL_BlitSurface(image, nullptr, target, &destination);
+            regions[loaded_paths[placed.image]] = region{nullptr, destination};
+        }
+
+        const std::size_t first_page = pages.size();
+        for (SDL_Surface* page_surface : page_surfaces) {
+            SDL_Texture* texture = page_surface ? SDL_CreateTextureFromSurface(renderer, page_surface) : nullptr;
+            if (texture) {
+                SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            }
+            pages.push_back(texture);
+            if (page_surface) {
+                SDL_FreeSurface(page_surface);
+            }
+        }
+        for (const placement& placed : placements) {
+            auto found = regions.find(loaded_paths[placed.image]);
+            if (found == regions.end()) {
+                continue; // Its page surface could not be created
+            }
+            found->second.page = pages[first_page + placed.page];
+            if (!found->second.page) {
+                regions.erase(found); // Page failed to upload, fall back to a texture of its own
+            }
+        }
+
+        for (SDL_Surface* surface : surfaces) {
+            SDL_FreeSurface(surface);
+        }
+    }
+
+    void clear()
+    {
+        for (SDL_Texture* page : pages) {
+            if (page) {
+                SDL_DestroyTexture(page);
+            }
+        }
+        pages.clear();
+        regions.clear();
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <iostream>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <entt/entt.hpp>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "../components/sprite.h"
+#include "../components/tilemap.h"
+#include "texture_atlas.hpp"
+
+// Reference counted textures keyed by file path.
+// Every sprite using the same image shares one SDL_Texture. Each acquire() is paired with a
+// release(), which the registry does for us when a sprite_texture_component goes away, and the
+// texture is freed when the last user lets go. Images can be decoded ahead of time on a
+// worker thread with preload_async(); the upload to the GPU always happens on the thread
+// that owns the renderer. Without a renderer (headless) nothing is ever loaded.
+// Images packed into the atlas are handed out as their atlas page instead; the page lives
+// until clear() and the sprite offsets its source rect by origin(path).
+struct texture_cache
+{
+    struct entry {
+        SDL_Texture* texture = nullptr;
+        int width = 0;
+        int height = 0;
+        int references = 0;
+    };
+
+    SDL_Renderer* renderer = nullptr;
+    std::unordered_map<std::string, entry> entries;
+    std::unordered_map<SDL_Texture*, std::string> paths; // Reverse lookup for release()
+    texture_atlas atlas;
+
+    ~texture_cache()
+    {
+        clear();
+    }
+
+    // Returns the shared texture for path and takes a reference to it
+    SDL_Texture* acquire(const std::string& path)
+    {
+        if (const texture_atlas::region* packed = atlas.find(path)) {
+            return packed->page;
+        }
+        entry* found = load(path);
+        if (!found) {
+            return nullptr;
+        }
+        found->references += 1;
+        return found->texture;
+    }
+
+    // Packs the images into shared atlas pages, call before any of them are acquired
+    void build_atlas(const std::vector<std::string>& atlas_paths)
+    {
+        atlas.build(renderer, atlas_paths);
+    }
+
+    // Top left of the image inside the texture acquire() returned for it
+    SDL_Point origin(const std::string& path) const
+    {
+        const texture_atlas::region* packed = atlas.find(path);
+        return packed ? SDL_Point{packed->rect.x, packed->rect.y} : SDL_Point{0, 0};
+    }
+
+    void release(SDL_Texture* texture)
+    {
+        auto path = paths.find(texture);
+        if (path == paths.end()) {
+            return;
+        }
+        auto found = entries.find(path->second);
+        found->second.references -= 1;
+        if (found->second.references <= 0) {
+            SDL_DestroyTexture(texture);
+            entries.erase(found);
+            paths.erase(path);
+        }
+    }
+
+    // Size of the image at path without holding on to it
+    bool dimensions(const std::string& path, int& width, int& height)
+    {
+        if (const texture_atlas::region* packed = atlas.find(path)) {
+            width = packed->rect.w;
+            height = packed->rect.h;
+            return true;
+        }
+        const bool already_loaded = entries.count(path) > 0;
+        entry* found = load(path);
+        if (!found) {
+            return false;
+        }
+        width = found->width;
+        height = found->height;
+        if (!already_loaded) {
+            release(found->texture);
+        }
+        return true;
+    }
+
+    // Hooked up to sprite_texture_component destruction so entities give their reference back
+    void on_sprite_destroyed(entt::registry& reg, entt::entity entity)
+    {
+        release(reg.get<sprite_texture_component>(entity).texture);
+    }
+
+    // The same for the textures in a tilemap's palette
+    void on_tilemap_destroyed(entt::registry& reg, entt::entity entity)
+    {
+        for (const tile_type& type : reg.get<tilemap_component>(entity).palette) {
+            if (type.texture) {
+                release(type.texture);
+            }
+        }
+    }
+
+    // Bytes of texture memory in use, assuming 32 bits per pixel
+    std::size_t memory_bytes() const
+    {
+        std::size_t bytes = 0;
+        for (const auto& [path, cached] : entries) {
+            bytes += static_cast<std::size_t>(cached.width) * cached.height * 4;
+        }
+        return bytes;
+    }
+
+    void report(std::ostream& out) const
+    {
+        out << "Texture cache: " << entries.size() << " textures, " << memory_bytes() / 1024 << " KB, "
+            << atlas.regions.size() << " images packed into " << atlas.pages.size() << " atlas pages\n";
+        for (const auto& [path, cached] : entries) {
+            out << "  " << path << " (" << cached.width << "x" << cached.height << ") references: " << cached.references << '\n';
+        }
+    }
+
+    // Decodes the images on a worker thread so a later acquire() only has to upload them
+    void preload_async(const std::vector<std::string>& preload_paths)
+    {
+        if (!renderer) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::string& path : preload_paths) {
+            if (entries.count(path) || m_decoded.count(path) || atlas.find(path)) {
+                continue;
+            }
+            m_decode_queue.push_back(path);
+            m_decoded[path] = nullptr; // Marks it as in flight
+        }
+        if (!m_worker.joinable()) {
+            m_worker = std::thread(&texture_cache::decode_worker, this);
+        }
+        m_condition.notify_one();
+    }
+
+    // Uploads whatever the worker has finished decoding, call once a frame
+    void upload_decoded()
+    {
+        std::unordered_map<std::string, SDL_Surface*> ready;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_decoded.begin(); it != m_decoded.end();) {
+                if (it->second) {
+                    ready.insert(*it);
+                    it = m_decoded.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& [path, surface] : ready) {
+            upload(path, surface);
+        }
+    }
+
+    // Frees every texture and stops the worker, must run before the renderer is destroyed
+    void clear()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_decode_queue.clear();
+        }
+        m_condition.notify_all();
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+        for (auto& [path, surface] : m_decoded) {
+            if (surface) {
+                SDL_FreeSurface(surface);
+            }
+        }
+        m_decoded.clear();
+
+        for (auto& [path, cached] : entries) {
+            SDL_DestroyTexture(cached.texture);
+        }
+        entries.clear();
+        paths.clear();
+        atlas.clear();
+    }
+
+private:
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::string> m_decode_queue;
+    std::unordered_map<std::string, SDL_Surface*> m_decoded; // nullptr while still decoding
+    bool m_stopping = false;
+
+    // Finds or loads the entry, waiting on the worker if it is decoding this path already
+    entry* load(const std::string& path)
+    {
+        auto found = entries.find(path);
+        if (found != entries.end()) {
+            return &found->second;
+        }
+        if (!renderer) {
+            return nullptr;
+        }
+
+        SDL_Surface* surface = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_decoded.count(path)) {
+                // The worker drops the path from m_decoded if it fails to decode it
+                m_condition.wait(lock, [&] {
+                    auto in_flight = m_decoded.find(path);
+                    return m_stopping || in_flight == m_decoded.end() || in_flight->second != nullptr;
+                });
+                auto in_flight = m_decoded.find(path);
+                if (in_flight != m_decoded.end()) {
+                    surface = in_flight->second;
+                    m_decoded.erase(in_flight);
+                }
+            }
+        }
+        if (!surface) {
+            surface = IMG_Load(path.c_str());
+        }
+        return upload(path, surface);
+    }
+
+    entry* upload(const std::string& path, SDL_Surface* surface)
+    {
+        if (!surface) {
+            SDL_Log("Failed to load texture %s: %s", path.c_str(), SDL_GetError());
+            return nullptr;
+        }
+
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+        entry loaded;
+        loaded.texture = texture;
+        loaded.width = surface->w;
+        loaded.height = surface->h;
+        SDL_FreeSurface(surface);
+        if (!texture) {
+            SDL_Log("Failed to upload texture %s: %s", path.c_str(), SDL_GetError());
+            return nullptr;
+        }
+
+        paths[texture] = path;
+        return &(entries[path] = loaded);
+    }
+
+    void decode_worker()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock, [&] { return m_stopping || !m_decode_queue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            const std::string path = m_decode_queue.front();
+            m_decode_queue.pop_front();
+
+            lock.unlock();
+            SDL_Surface* surface = IMG_Load(path.c_str());
+            lock.lock();
+
+            if (!surface) {
+                SDL_Log("Failed to decode %s: %s", path.c_str(), SDL_GetError());
+                m_decoded.erase(path);
+            } else {
+                m_decoded[path] = surface;
+            }
+            m_condition.notify_all();
+        }
+    }
+};